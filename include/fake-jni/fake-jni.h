@@ -260,6 +260,10 @@ namespace FakeJni {
                                         static std::shared_ptr<jnivm::Class> getDescriptor();\
                                         virtual std::shared_ptr<jnivm::Class> getClassInternal(jnivm::ENV* env) override {\
                                             return getDescriptor();\
+                                        }\
+                                        virtual jnivm::Class* getClassBorrowed(jnivm::ENV* env, std::shared_ptr<jnivm::Class>& owner) override {\
+                                            owner = getDescriptor();\
+                                            return owner.get();\
                                         }
 #define BEGIN_NATIVE_DESCRIPTOR(name, ...)  std::shared_ptr<jnivm::Class> name ::getDescriptor() {\
                                                 auto cl = jnivm::ENV::FromJNIEnv(&FakeJni::JniEnvContext().getJniEnv())->GetClass< name >( name ::getClassName().data());\
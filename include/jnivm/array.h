@@ -20,8 +20,12 @@ namespace jnivm {
             jsize length = 0;
             void* data = nullptr;
         protected:
-            Array() {}
-            Array(void* data, jsize length) : data(data), length(length) {}
+            Array() {
+                kind = ObjectKind::Array;
+            }
+            Array(void* data, jsize length) : data(data), length(length) {
+                kind = ObjectKind::Array;
+            }
             void setArray(void* data) {
                 this->data = data;
             }
@@ -1,11 +1,14 @@
 #pragma once
 #include "object.h"
 #include <mutex>
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 #include <functional>
 #include "array.h"
 #include "internal/findclass.h"
+#include "internal/memberIndex.h"
+#include "internal/lockProfiler.h"
 namespace jnivm {
     class ENV;
     template<class Funk, class ...EnvOrObjOrClass> struct Wrap;
@@ -17,7 +20,7 @@ namespace jnivm {
 
     class Class : public Object {
     public:
-        std::mutex mtx;
+        ClassMutex mtx;
         std::unordered_map<std::string, void*> natives;
         std::string name;
         std::string nativeprefix;
@@ -26,21 +29,48 @@ namespace jnivm {
 #endif
         std::vector<std::shared_ptr<Field>> fields;
         std::vector<std::shared_ptr<Method>> methods;
+        // Lookup tables of fields and methods, use the functions below to keep them in sync
+        MemberIndex<Field> fieldindex;
+        MemberIndex<Method> methodindex;
+        // Maps a called jmethodID to the most derived hooked override of this class, guarded by mtx
+        // Dropped once vtableepoch doesn't match VM::vtablerevision of the VM owning this class anymore
+        std::unordered_map<Method*, Method*> vtable;
+        std::size_t vtableepoch = 0;
+        // Set by ENV::GetClass<T> once a native type is attached to this class
+        std::atomic<bool> nativetype { false };
         std::function<std::shared_ptr<Object>(ENV* env)> Instantiate;
         std::function<std::shared_ptr<Array<Object>>(ENV* env, jsize length)> InstantiateArray;
         std::function<std::vector<std::shared_ptr<Class>>(ENV*)> baseclasses;
 
         Class() {
-
+            kind = ObjectKind::Class;
         }
 
         MethodProxy getMethod(const char* sig, const char* name);
 
+        // The following functions require the caller to hold mtx
+        Method* FindMethod(const char* name, const char* signature, MemberKind kind) const;
+        Method* FindMethod(const std::string& name, const std::string& signature, MemberKind kind) const;
+        void AddMethod(std::shared_ptr<Method> method);
+        void RemoveMethod(Method* method);
+        Field* FindField(const char* name, const char* signature, MemberKind kind) const;
+        Field* FindField(const std::string& name, const std::string& signature, MemberKind kind) const;
+        void AddField(std::shared_ptr<Field> field);
+
+        // Resolves the implementation of method for objects of this class, caches the result in vtable
+        // Must not be called while holding mtx
+        Method* GetVirtualOverride(ENV* env, Method* method);
+        // Needs to be called after hooks, natives or base classes have changed, to drop every vtable of the VM of env
+        static void InvalidateVTables(ENV* env);
+
         std::string getName() const {
             return nativeprefix;
         }
 
         template<class T> void Hook(ENV* env, const std::string& method, T&& t);
+        // Hooks t as static method with an explicit JNI signature, e.g. to take a Java interface as Object
+        // The signature must have the same number and kinds of parameters as t
+        template<class T> void Hook(ENV* env, const std::string& method, const std::string& signature, T&& t);
         template<class T> void HookInstance(ENV* env, const std::string& id, T&& t);
         template<class T> void HookInstanceFunction(ENV* env, const std::string& id, T&& t);
         template<class T> void HookInstanceGetterFunction(ENV* env, const std::string& id, T&& t);
@@ -72,8 +102,8 @@ namespace jnivm {
             static void install(ENV* env, Class* cl, const std::string& id, T&& t) {
                 // Filter false positives at runtime
                 if((int)bind & (int)FunctionType::Instance ? !std::is_same<Object*, typename Function<T>::template Parameter<1>>::value && !std::is_same<jobject, typename Function<T>::template Parameter<1>>::value : !std::is_same<Class*, typename Function<T>::template Parameter<1>>::value && !std::is_same<jclass, typename Function<T>::template Parameter<1>>::value) {
-                    auto oc = env->GetVM()->typecheck.find(typeid(std::remove_pointer_t<typename Function<T>::template Parameter<1>>));
-                    if(oc == env->GetVM()->typecheck.end() || oc->second.get() != cl) {
+                    auto oc = env->GetVM()->FindType(typeid(std::remove_pointer_t<typename Function<T>::template Parameter<1>>));
+                    if(oc.get() != cl) {
                         return;
                     }
                 }
@@ -85,8 +115,8 @@ namespace jnivm {
             static void install(ENV* env, Class* cl, const std::string& id, T&& t) {
                 // Filter false positives at runtime
                 if((int)bind & (int)FunctionType::Instance ? !std::is_same<Object*, typename Function<T>::template Parameter<0>>::value && !std::is_same<jobject, typename Function<T>::template Parameter<0>>::value : !std::is_same<Class*, typename Function<T>::template Parameter<0>>::value && !std::is_same<jclass, typename Function<T>::template Parameter<0>>::value) {
-                    auto oc = env->GetVM()->typecheck.find(typeid(std::remove_pointer_t<typename Function<T>::template Parameter<0>>));
-                    if(oc == env->GetVM()->typecheck.end() || oc->second.get() != cl) {
+                    auto oc = env->GetVM()->FindType(typeid(std::remove_pointer_t<typename Function<T>::template Parameter<0>>));
+                    if(oc.get() != cl) {
                         return;
                     }
                 }
@@ -114,6 +144,11 @@ namespace jnivm {
         impl::HookManagerHelper2<T, Function<T>::type>::install(env, this, id, std::move(t));
     }
 
+    template<class T> void Class::Hook(ENV* env, const std::string& id, const std::string& signature, T&& t) {
+        using w = std::conditional_t<std::is_same<typename Function<T>::template Parameter<0>, JNIEnv*>::value || std::is_same<typename Function<T>::template Parameter<0>, ENV*>::value, Wrap<T, typename Function<T>::template Parameter<0>>, Wrap<T>>;
+        HookManager<FunctionType::None, w>::installAs(env, this, id, signature, std::move(t));
+    }
+
     template<class T> void Class::HookInstance(ENV * env, const std::string & id, T && t) {
         impl::HookManagerHelper2<T, (FunctionType)((int)Function<T>::type | (int)FunctionType::Instance)>::install(env, this, id, std::move(t));
     }
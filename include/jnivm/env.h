@@ -1,9 +1,12 @@
 #ifndef JNIVM_ENV_H_1
 #define JNIVM_ENV_H_1
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
-#include <forward_list>
 #include <jni.h>
+#include "internal/localReferenceTable.h"
+#include "internal/objectPool.h"
 
 namespace jnivm {
     class VM;
@@ -17,16 +20,36 @@ namespace jnivm {
         JNINativeInterface ninterface;
         // Holder of the invocation table
         JNIEnv env;
+        friend class VM;
+        // Created by VM::CreateEnv, may be reused by another thread after its thread detached
+        bool reusable = false;
+        // VM::interfaceversion of ninterface
+        std::uint64_t interfaceversion = 0;
+        // Releases all local references and the pending exception, like a new ENV
+        void Reset();
+        void MonitorLocalReferences();
     protected:
         void OverrideJNINativeInterface(const JNINativeInterface& ninterface);
     public:
 #ifdef EnableJNIVMGC
         // All explicit local Objects are stored here controlled by push and pop localframe
-        std::forward_list<std::vector<std::shared_ptr<Object>>> localframe;
-        // save previous poped vector frames here, precleared
-        std::forward_list<std::vector<std::shared_ptr<Object>>> freeframes;
+        LocalReferenceTable localrefs;
+#endif
+#ifdef EnableJNIVMPool
+        // Allocates strings, arrays and reference wrappers created by this thread, reset it to disable pooling for this ENV
+        std::shared_ptr<ObjectPool> pool;
 #endif
         std::shared_ptr<Throwable> current_exception;
+        // Releases the memory kept by pool once none of its objects is alive, called by PopLocalFrame and on detach
+        void TrimPool();
+        // Allocates T from the pool of this ENV if enabled, on the thread owning it
+        template<class T, class... Args> std::shared_ptr<T> MakeShared(Args&&... args) {
+#ifdef EnableJNIVMPool
+            return jnivm::MakeShared<T>(pool.get(), std::forward<Args>(args)...);
+#else
+            return std::make_shared<T>(std::forward<Args>(args)...);
+#endif
+        }
         ENV(const ENV&) = delete;
         ENV(ENV&&) = delete;
         ENV(VM * vm, const JNINativeInterface & defaultinterface);
@@ -38,6 +61,13 @@ namespace jnivm {
         VM* GetVM();
         JNIEnv* GetJNIEnv();
         static ENV* FromJNIEnv(JNIEnv * env);
+
+        // Calls the instance method id on count receivers like a loop over Call<Type>MethodA, overrides are resolved once per receiver class
+        // Row i of the argument matrix starts at args + i * stride, pass stride 0 to reuse the same arguments for every call
+        // results may be nullptr, otherwise it receives count return values, objects are returned as local references of this ENV
+        // Stops at the first call raising an exception and returns its index, the exception stays pending. Returns count on success
+        // Hooks marked via Method::threadsafe are split across the calling thread and up to threads - 1 workers of VM::GetExecutor
+        std::size_t CallMethodBatch(jmethodID id, const jobject* receivers, std::size_t count, const jvalue* args, std::size_t stride, jvalue* results, std::size_t threads = 1);
     };
 }
 #endif
@@ -62,9 +92,8 @@ namespace jnivm {
             static_assert(std::is_base_of<Object, T>::value, "You have to public extend jnivm::Object / FakeJni::JObject");
             return [](ENV* env) -> std::shared_ptr<jnivm::Object> {
                 auto res = std::make_shared<T>();
-                auto f = env->GetVM()->typecheck.find(typeid(T));
-                if(f != env->GetVM()->typecheck.end()) {
-                    res->clazz = f->second;
+                if(auto clazz = env->GetVM()->FindType(typeid(T))) {
+                    res->clazz = clazz;
                 }
                 return res;
             };
@@ -85,10 +114,14 @@ namespace jnivm {
 }
 
 template<class T> std::shared_ptr<jnivm::Class> jnivm::ENV::GetClass(const char *name) {
-    std::lock_guard<std::mutex> lock(vm->mtx);
-    auto& c = vm->typecheck[typeid(T)] = GetClass(name);
+    // Looked up before taking typecheckmtx, so it is never held together with classesmtx
+    auto cl = GetClass(name);
+    std::lock_guard<TypeCheckMutex> lock(vm->typecheckmtx);
+    auto& c = vm->typecheck[typeid(T)] = cl;
     c->Instantiate = jnivm::Factory<T>::CreateLambda();
+    c->nativetype = true;
     IsClass<T>::AddInherience(c, this);
+    Class::InvalidateVTables(this);
     return c;
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+#include <jni.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace jnivm {
+    class VM;
+    class ENV;
+    class Object;
+    class Throwable;
+
+    // Outcome of Executor::Invoke
+    struct InvokeResult {
+        // Zero if the call raised an exception, value.l points to object for object results
+        jvalue value;
+        // Keeps an object result alive, the local reference of the worker is released after the call
+        std::shared_ptr<Object> object;
+        // Exception raised by the call, it is no longer pending on any ENV
+        std::shared_ptr<Throwable> exception;
+    };
+
+    // Worker threads owned by a VM, each with an ENV attached for its whole lifetime
+    // Every worker has its own queue, tasks submitted by a worker stay on its queue, other tasks are spread round robin
+    // Idle workers take the newest task of their own queue and steal the oldest task of another queue
+    class Executor {
+    public:
+        // Starts threads workers, at least one
+        Executor(VM* vm, std::size_t threads);
+        // Finishes all queued tasks, then detaches and joins the workers
+        ~Executor();
+        Executor(const Executor&) = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        // Runs f(ENV*) on a worker inside its own local frame, local references created by f are released afterwards
+        // Exceptions thrown by f are stored in the future, an exception f leaves pending on the ENV is cleared
+        // Tasks waiting for tasks they submitted have to use Wait instead of get, otherwise all workers may block each other
+        template<class F> auto Submit(F&& f) -> std::future<decltype(f(std::declval<ENV*>()))>;
+        // Like future.get(), but a worker of this executor runs queued tasks until the future is ready
+        template<class R> R Wait(std::future<R>& future);
+        // Calls id on a worker like Call<Type>MethodA, or CallStatic<Type>MethodA with receiver as jclass for static methods
+        // receiver and object arguments have to stay valid until the future is ready, like global references
+        std::future<InvokeResult> Invoke(jmethodID id, jobject receiver, std::vector<jvalue> args);
+
+        std::size_t Threads() const {
+            return workers.size();
+        }
+
+    private:
+        struct Task {
+            virtual ~Task() = default;
+            virtual void Run(ENV* env) = 0;
+        };
+        template<class R> struct PackagedTask : Task {
+            std::packaged_task<R(ENV*)> task;
+            template<class F> PackagedTask(F&& f) : task(std::forward<F>(f)) {}
+            void Run(ENV* env) override {
+                task(env);
+            }
+        };
+        struct Worker {
+            std::mutex mtx;
+            std::deque<std::unique_ptr<Task>> tasks;
+            std::thread thread;
+        };
+
+        VM* vm;
+        std::vector<std::unique_ptr<Worker>> workers;
+        // Guards pending and stop, idle workers sleep on wakeup
+        std::mutex mtx;
+        std::condition_variable wakeup;
+        std::size_t pending = 0;
+        bool stop = false;
+        // Queue of the next task submitted by a thread outside of this executor
+        std::atomic<std::size_t> next { 0 };
+
+        void Push(std::unique_ptr<Task> task);
+        // True if called by one of the workers of this executor
+        bool IsWorker() const;
+        // Runs one queued task on the calling worker, false if the caller isn't a worker or nothing is queued
+        bool Help();
+        std::unique_ptr<Task> Pop(std::size_t self);
+        void Run(std::size_t self);
+        static void RunTask(ENV* env, Task& task);
+    };
+
+    template<class F> auto Executor::Submit(F&& f) -> std::future<decltype(f(std::declval<ENV*>()))> {
+        using R = decltype(f(std::declval<ENV*>()));
+        std::unique_ptr<PackagedTask<R>> task(new PackagedTask<R>(std::forward<F>(f)));
+        auto future = task->task.get_future();
+        Push(std::move(task));
+        return future;
+    }
+
+    template<class R> R Executor::Wait(std::future<R>& future) {
+        // Other threads can't run tasks, they just block
+        if(!IsWorker()) {
+            return future.get();
+        }
+        while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if(!Help()) {
+                // Nothing to help with, the awaited task is running on another worker
+                future.wait_for(std::chrono::microseconds(100));
+            }
+        }
+        return future.get();
+    }
+}
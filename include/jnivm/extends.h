@@ -14,7 +14,7 @@ namespace jnivm {
             template<class T>
             using ArrayBaseType = ArrayBase<T, BaseClasses...>;
             static std::vector<std::shared_ptr<Class>> GetBaseClasses(ENV* env) {
-                std::vector<std::shared_ptr<Class>> ret = { env->GetVM()->typecheck[typeid(BaseClasses)]... };
+                std::vector<std::shared_ptr<Class>> ret = { env->GetVM()->FindType(typeid(BaseClasses))... };
 #ifndef NDEBUG
                 for(size_t i = 0, size = ret.size(); i < size; ++i) {
                     if(!ret[i]) {
@@ -3,6 +3,8 @@
 #include <string>
 
 #include "methodhandlebase.h"
+#include "internal/memberIndex.h"
+#include "internal/stub.h"
 
 namespace jnivm {
 
@@ -13,6 +15,15 @@ namespace jnivm {
         bool _static = false;
         std::shared_ptr<MethodHandle> getnativehandle;
         std::shared_ptr<MethodHandle> setnativehandle;
+        // Used if getnativehandle or setnativehandle is not set
+        Stub stub;
+
+        MemberKind GetKind() const {
+            return _static ? MemberKind::Static : MemberKind::Instance;
+        }
+        const std::string& GetSignature() const {
+            return type;
+        }
 #ifdef JNI_DEBUG
         std::string GenerateHeader();
         std::string GenerateStubs(std::string scope, const std::string &cname);
@@ -45,44 +45,27 @@ namespace jnivm {
 
     template<class w, class W, bool isStatic> struct FunctionBase {
         template<class T> static void install(ENV* env, Class * cl, const std::string& id, T&& t) {
-            auto ssig = InvokeSignature<isStatic, typename w::Wrapper>::Get(env);
-            auto ccl =
-                    std::find_if(cl->methods.begin(), cl->methods.end(),
-                                            [&id, &ssig](std::shared_ptr<Method> &m) {
-                                                return m->_static == isStatic && m->name == id && m->signature == ssig;
-                                            });
-            std::shared_ptr<Method> method;
-            if (ccl != cl->methods.end()) {
-                method = *ccl;
-            } else {
-                method = std::make_shared<Method>();
-                method->name = id;
-                method->_static = isStatic;
-                method->signature = std::move(ssig);
-                cl->methods.push_back(method);
-            }
-            method->nativehandle = std::make_shared<W>(typename w::Wrapper {t});
+            installAs(env, cl, id, InvokeSignature<isStatic, typename w::Wrapper>::Get(env), t);
         }
 
         template<class T> static void install(ENV* env, Class * cl, const std::string& id, const std::string& signature, T&& t) {
-            auto ssig = signature;
             static_assert(Function<T>::plength == 3 && std::is_same<typename Function<T>::Return, jvalue>::value  && std::is_same<typename Function<T>::template Parameter<0>,JNIEnv*>::value && std::is_same<typename Function<T>::template Parameter<2>,jvalue*>::value, "Invalid arbitary function");
-            auto ccl =
-                    std::find_if(cl->methods.begin(), cl->methods.end(),
-                                            [&id, &ssig](std::shared_ptr<Method> &m) {
-                                                return m->_static == isStatic && m->name == id && m->signature == ssig;
-                                            });
-            std::shared_ptr<Method> method;
-            if (ccl != cl->methods.end()) {
-                method = *ccl;
-            } else {
-                method = std::make_shared<Method>();
-                method->name = id;
-                method->_static = isStatic;
-                method->signature = std::move(ssig);
-                cl->methods.push_back(method);
+            installAs(env, cl, id, signature, t);
+        }
+
+        // Installs the wrapped function under ssig instead of the signature derived from its parameters
+        template<class T> static void installAs(ENV* env, Class * cl, const std::string& id, std::string ssig, T&& t) {
+            std::lock_guard<ClassMutex> lock(cl->mtx);
+            auto method = cl->FindMethod(id, ssig, isStatic ? MemberKind::Static : MemberKind::Instance);
+            if (!method) {
+                auto m = std::make_shared<Method>(id, std::move(ssig), isStatic);
+                method = m.get();
+                cl->AddMethod(std::move(m));
             }
             method->nativehandle = std::make_shared<W>(typename w::Wrapper {t});
+            if(!isStatic) {
+                Class::InvalidateVTables(env);
+            }
         }
     };
 
@@ -99,43 +82,33 @@ namespace jnivm {
     template<class w, class W, bool isStatic, bool isGetter, class handle_t, handle_t handle> struct PropertyBase {
         template<class T> static void install(ENV* env, Class * cl, const std::string& id, T&& t) {
             auto ssig = PropertySignature<isStatic, isGetter, typename w::Wrapper>::Get(env);
-            auto ccl =
-                    std::find_if(cl->fields.begin(), cl->fields.end(),
-                                            [&id, &ssig](std::shared_ptr<Field> &f) {
-                                                return f->_static == isStatic && f->name == id && f->type == ssig;
-                                            });
-            std::shared_ptr<Field> field;
-            if (ccl != cl->fields.end()) {
-                field = *ccl;
-            } else {
-                field = std::make_shared<Field>();
-                field->name = id;
-                field->_static = isStatic;
-                field->type = std::move(ssig);
-                cl->fields.push_back(field);
+            std::lock_guard<ClassMutex> lock(cl->mtx);
+            auto field = cl->FindField(id, ssig, isStatic ? MemberKind::Static : MemberKind::Instance);
+            if (!field) {
+                auto f = std::make_shared<Field>();
+                f->name = id;
+                f->_static = isStatic;
+                f->type = std::move(ssig);
+                field = f.get();
+                cl->AddField(std::move(f));
             }
-            field.get()->*handle = std::make_shared<W>(typename w::Wrapper {t});
+            field->*handle = std::make_shared<W>(typename w::Wrapper {t});
         }
 
         template<class T> static void install(ENV* env, Class * cl, const std::string& id, const std::string& signature, T&& t) {
             static_assert(Function<T>::plength == 3 && std::is_same<typename Function<T>::Return, jvalue>::value && std::is_same<typename Function<T>::template Parameter<0>,JNIEnv*>::value && std::is_same<typename Function<T>::template Parameter<2>,jvalue*>::value, "Invalid arbitary function");
             auto ssig = signature;
-            auto ccl =
-                    std::find_if(cl->fields.begin(), cl->fields.end(),
-                                            [&id, &ssig](std::shared_ptr<Field> &f) {
-                                                return f->_static == isStatic && f->name == id && f->type == ssig;
-                                            });
-            std::shared_ptr<Field> field;
-            if (ccl != cl->fields.end()) {
-                field = *ccl;
-            } else {
-                field = std::make_shared<Field>();
-                field->name = id;
-                field->_static = isStatic;
-                field->type = std::move(ssig);
-                cl->fields.push_back(field);
+            std::lock_guard<ClassMutex> lock(cl->mtx);
+            auto field = cl->FindField(id, ssig, isStatic ? MemberKind::Static : MemberKind::Instance);
+            if (!field) {
+                auto f = std::make_shared<Field>();
+                f->name = id;
+                f->_static = isStatic;
+                f->type = std::move(ssig);
+                field = f.get();
+                cl->AddField(std::move(f));
             }
-            field.get()->*handle = std::make_shared<W>(typename w::Wrapper {t});
+            field->*handle = std::make_shared<W>(typename w::Wrapper {t});
         }
     };
 
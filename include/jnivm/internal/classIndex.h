@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jnivm {
+    class Class;
+
+    // Lock free lookup of the entries of VM::classes by name, without building a std::string
+    // Insert only open addressing table of pointers to the map entries, which never move or get erased
+    // Growing publishes a new table, old tables stay alive until the index is destroyed, so readers never block
+    class ClassIndex {
+    public:
+        using Entry = std::pair<const std::string, std::shared_ptr<Class>>;
+        // Power of two, grows once half of the buckets are used
+        static constexpr std::size_t InitialSize = 64;
+
+        ClassIndex();
+        ClassIndex(const ClassIndex&) = delete;
+        ClassIndex& operator=(const ClassIndex&) = delete;
+
+        // Lock free, returns nullptr if name wasn't published yet
+        const Entry* Find(const char* name) const;
+        // Requires the exclusive lock of the map owning entry, publishing the same name again does nothing
+        void Publish(const Entry* entry);
+        // Number of published entries, requires the same lock as Publish
+        std::size_t Size() const {
+            return size;
+        }
+
+    private:
+        struct Bucket {
+            std::atomic<std::uint64_t> hash;
+            std::atomic<const Entry*> entry;
+        };
+        struct Table {
+            std::size_t mask;
+            std::unique_ptr<Bucket[]> buckets;
+        };
+
+        std::atomic<const Table*> current;
+        // The current and all retired tables
+        std::vector<std::unique_ptr<Table>> tables;
+        std::size_t size = 0;
+
+        static std::unique_ptr<Table> NewTable(std::size_t size);
+        static std::uint64_t Hash(const char* name);
+        static void Insert(const Table& table, std::uint64_t hash, const Entry* entry);
+        void Grow();
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace jnivm {
+    class Object;
+    class Weak;
+
+    // Global and weak global references of one VM
+    // Split into shards with their own lock and free list, every thread adds to its own shard
+    // A reference is identified by the id returned from Add, which encodes shard and slot
+    // Weak references with a destroyed target are swept incrementally, which releases the control block of the target
+    // The wrapper itself stays until it is deleted, its jweak handle must remain valid
+    class GlobalReferenceTable {
+    public:
+        static constexpr std::size_t Shards = 16;
+        static constexpr std::uint32_t None = UINT32_MAX;
+        // Slots of its shard swept by every AddWeak
+        static constexpr std::size_t SweepPerWeak = 2;
+
+        struct WeakStats {
+            // Weak references not yet found dead by a sweep
+            std::size_t live;
+            // Weak references with a released target, which were not deleted yet
+            std::size_t dead;
+        };
+
+        // Called with Peak whenever a shard needs a new slot, without holding any lock
+        std::function<void(std::size_t)> onpeak;
+
+        // obj must not be nullptr
+        std::uint32_t Add(std::shared_ptr<Object> obj);
+        // weak must not be nullptr
+        std::uint32_t AddWeak(std::shared_ptr<Weak> weak);
+        // Returns false if id is not a live reference to obj
+        bool Remove(std::uint32_t id, const Object* obj);
+        // Sweeps up to budget slots of the next shard in round robin order, returns the number of released targets
+        std::size_t Sweep(std::size_t budget);
+        // Sweeps all slots, returns the number of released targets
+        std::size_t Collect();
+        // Number of live references of all shards
+        std::size_t Size();
+        // Sum of the maximal number of references of every shard, an upper bound of the maximum of Size
+        std::size_t Peak() const {
+            return allocated.load(std::memory_order_relaxed);
+        }
+        WeakStats Weaks();
+
+    private:
+        struct Entry {
+            std::shared_ptr<Object> ref;
+            // Set for weak references
+            Weak* weak = nullptr;
+            bool dead = false;
+        };
+        struct Shard {
+            std::mutex mtx;
+            std::vector<Entry> slots;
+            std::vector<std::uint32_t> freelist;
+            // Next slot to sweep
+            std::size_t cursor = 0;
+            std::size_t weak = 0;
+            std::size_t dead = 0;
+        };
+        Shard shards[Shards];
+        std::atomic<std::size_t> nextsweep { 0 };
+        // Slots of all shards, only changes if a shard grows
+        std::atomic<std::size_t> allocated { 0 };
+
+        void Grown();
+        // Both require the lock of shard
+        static std::uint32_t Insert(Shard& shard, std::size_t index, Entry entry);
+        static std::size_t SweepShard(Shard& shard, std::size_t budget);
+    };
+}
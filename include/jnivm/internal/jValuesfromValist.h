@@ -1,7 +1,10 @@
 #include <jni.h>
 #include <vector>
 #include <cstdarg>
+#include "signature.h"
 
 namespace jnivm {
     std::vector<jvalue> JValuesfromValist(va_list list, const char* signature);
-}
\ No newline at end of file
+    // Allocation free variant, values needs room for signature.parameters.size() elements
+    void JValuesfromValist(va_list list, const MethodSignature& signature, jvalue* values);
+}
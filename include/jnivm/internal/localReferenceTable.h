@@ -0,0 +1,165 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace jnivm {
+    class Object;
+
+    // Local references of one ENV, stored in slots of a stack of frames
+    // jobject handles stay plain Object pointers, an index from object to its newest slot makes DeleteLocalRef O(1)
+    // Slots of an object are chained from newest to oldest, freed slots are reused by the frame owning them
+    // All frames share one slot arena, pushing and popping a frame only moves its base. Memory of a burst beyond
+    // the retention cap is released once the frames using it are popped
+    // Not thread safe, only the thread of the owning ENV may use it
+    class LocalReferenceTable {
+    public:
+        static constexpr std::uint32_t None = UINT32_MAX;
+        // Default of retain
+        static constexpr std::size_t DefaultRetain = 4096;
+
+        // Slot and generation of a reference, the generation changes once the slot is released
+        struct LocalRef {
+            std::uint32_t index;
+            std::uint32_t generation;
+        };
+
+        struct Stats {
+            // Live references of all frames
+            std::size_t live;
+            // Maximum of live since the table was created
+            std::size_t peak;
+            std::size_t frames;
+            // Live references of the current frame
+            std::size_t framerefs;
+            std::size_t pushed;
+            std::size_t popped;
+            // PopFrame calls without a pushed frame, which only cleared the bottom frame
+            std::size_t underflows;
+            // Allocated slots and buckets of the index
+            std::size_t capacity;
+            std::size_t buckets;
+            // Number of times PopFrame released memory
+            std::size_t shrinks;
+        };
+
+        // Called with the new maximum whenever the number of live references exceeds its previous maximum
+        std::function<void(std::size_t)> onpeak;
+        // Slots kept by PopFrame, the arena and index shrink once more than twice as many as retain and the ones in use are allocated
+        std::size_t retain = DefaultRetain;
+
+        LocalReferenceTable();
+
+        // obj must not be nullptr
+        LocalRef Add(std::shared_ptr<Object> obj) {
+            auto&& frame = frames.back();
+            std::uint32_t index;
+            if(frame.freelist != None) {
+                index = frame.freelist;
+                frame.freelist = slots[index].next;
+            } else {
+                if(top == slots.size()) {
+                    slots.emplace_back();
+                }
+                index = top++;
+            }
+            auto&& slot = slots[index];
+            auto&& head = FindOrInsert(obj.get());
+            slot.next = head;
+            head = index;
+            slot.ref = std::move(obj);
+            if(++live > peak) {
+                NewPeak();
+            }
+            return { index, slot.generation };
+        }
+        // Adds a reference without owning obj, which has to outlive this table or all frames referencing it
+        LocalRef AddPinned(Object* obj) {
+            // Aliasing an empty shared_ptr has no control block, so neither adding nor releasing it is atomic
+            return Add(std::shared_ptr<Object>(std::shared_ptr<Object>(), obj));
+        }
+        // Releases the newest reference to obj, returns false if obj has no local reference in this table
+        bool Remove(Object* obj);
+        bool Contains(Object* obj) const;
+        // Returns nullptr if ref was released
+        Object* Get(LocalRef ref) const;
+
+        void PushFrame(std::size_t capacity);
+        // Releases all references of the current frame, the bottom frame is cleared but never removed
+        // Returns false if only the bottom frame was left
+        bool PopFrame();
+        // Releases the references of all frames and clears the counters, keeps memory up to retain for reuse
+        void Reset();
+        // Ensures capacity additional references fit without reallocation
+        void Reserve(std::size_t capacity);
+
+        // Number of live references of all frames
+        std::size_t Size() const {
+            return live;
+        }
+        std::size_t Frames() const {
+            return frames.size();
+        }
+        Stats GetStats() const;
+
+    private:
+        struct Slot {
+            std::shared_ptr<Object> ref;
+            std::uint32_t generation = 0;
+            // Older slot of the same object while live, next free slot of the same frame otherwise
+            std::uint32_t next = None;
+        };
+        struct Frame {
+            std::uint32_t base;
+            std::uint32_t freelist;
+        };
+        struct Bucket {
+            Object* key;
+            std::uint32_t head;
+        };
+
+        std::vector<Slot> slots;
+        // Slots below top belong to a frame
+        std::uint32_t top = 0;
+        std::vector<Frame> frames;
+        std::size_t live = 0;
+        std::size_t peak = 0;
+        std::size_t pushed = 0;
+        std::size_t popped = 0;
+        std::size_t underflows = 0;
+        std::size_t shrinks = 0;
+        // Open addressing map from object to its newest slot, power of two size
+        std::vector<Bucket> buckets;
+        std::size_t used = 0;
+
+        std::size_t BucketOf(const Object* obj) const {
+            // Fibonacci hashing, the low bits of a pointer are mostly zero
+            return static_cast<std::size_t>((reinterpret_cast<std::uintptr_t>(obj) * 11400714819323198485ull) >> 32) & (buckets.size() - 1);
+        }
+        std::uint32_t& FindOrInsert(Object* obj) {
+            if((used + 1) * 2 > buckets.size()) {
+                Rehash(buckets.size() * 2);
+            }
+            for(auto i = BucketOf(obj);; i = (i + 1) & (buckets.size() - 1)) {
+                auto&& bucket = buckets[i];
+                if(bucket.key == obj) {
+                    return bucket.head;
+                }
+                if(!bucket.key) {
+                    bucket.key = obj;
+                    bucket.head = None;
+                    ++used;
+                    return bucket.head;
+                }
+            }
+        }
+        std::size_t Find(const Object* obj) const;
+        void Erase(std::size_t bucket);
+        void Rehash(std::size_t size);
+        void Release(std::uint32_t index);
+        void NewPeak();
+        void Shrink();
+    };
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <jnivm/lockProfile.h>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace jnivm {
+
+    // Locks recorded by the lock profiler, every instance of a kind shares one LockProfile
+    enum class LockKind {
+        Classes,
+        TypeCheck,
+        Env,
+        Pinned,
+        Hook,
+        Class,
+        Object,
+        Count
+    };
+
+    namespace lockprofiler {
+        // Steady clock in nanoseconds
+        std::uint64_t Now();
+        void Record(LockKind kind, bool contended, std::uint64_t waitns);
+        // Profiles of all kinds acquired at least once, sorted by wait time. Empty without EnableJNIVMLockProfiler
+        std::vector<LockProfile> Collect();
+        // Not synchronized with threads acquiring locks at the same time, their acquisitions may be lost
+        void Reset();
+        // One line per lock followed by its callsites
+        std::string Format(const std::vector<LockProfile>& profiles);
+    }
+
+#ifdef EnableJNIVMLockProfiler
+    // Attributes the locks taken by this thread to name until it is destroyed, unless an enclosing LockCallsite named them already
+    // So nested calls are counted as the JNI function called by native code, not as jnivm internals
+    class LockCallsite {
+        const char* previous;
+    public:
+        LockCallsite(const char* name);
+        ~LockCallsite();
+        LockCallsite(const LockCallsite&) = delete;
+        LockCallsite& operator=(const LockCallsite&) = delete;
+    };
+
+    // Records every acquisition of the wrapped mutex, only a try_lock is added if it isn't contended
+    template<class M, LockKind kind> class ProfiledMutex {
+        M mtx;
+    public:
+        void lock() {
+            if(mtx.try_lock()) {
+                lockprofiler::Record(kind, false, 0);
+                return;
+            }
+            auto start = lockprofiler::Now();
+            mtx.lock();
+            lockprofiler::Record(kind, true, lockprofiler::Now() - start);
+        }
+        bool try_lock() {
+            if(!mtx.try_lock()) {
+                return false;
+            }
+            lockprofiler::Record(kind, false, 0);
+            return true;
+        }
+        void unlock() {
+            mtx.unlock();
+        }
+        void lock_shared() {
+            if(mtx.try_lock_shared()) {
+                lockprofiler::Record(kind, false, 0);
+                return;
+            }
+            auto start = lockprofiler::Now();
+            mtx.lock_shared();
+            lockprofiler::Record(kind, true, lockprofiler::Now() - start);
+        }
+        bool try_lock_shared() {
+            if(!mtx.try_lock_shared()) {
+                return false;
+            }
+            lockprofiler::Record(kind, false, 0);
+            return true;
+        }
+        void unlock_shared() {
+            mtx.unlock_shared();
+        }
+    };
+    template<LockKind kind> using Mutex = ProfiledMutex<std::mutex, kind>;
+    template<LockKind kind> using SharedMutex = ProfiledMutex<std::shared_timed_mutex, kind>;
+
+    // Names the JNI function for the locks taken until the end of the enclosing scope
+#define JNIVM_LOCK_CALLSITE(name) ::jnivm::LockCallsite jnivmlockcallsite(name)
+#else
+    // Plain mutexes unless built with JNIVM_ENABLE_LOCK_PROFILER
+    template<LockKind kind> using Mutex = std::mutex;
+    template<LockKind kind> using SharedMutex = std::shared_timed_mutex;
+
+#define JNIVM_LOCK_CALLSITE(name)
+#endif
+
+    using ClassesMutex = SharedMutex<LockKind::Classes>;
+    using TypeCheckMutex = SharedMutex<LockKind::TypeCheck>;
+    using EnvMutex = Mutex<LockKind::Env>;
+    using PinnedMutex = Mutex<LockKind::Pinned>;
+    using HookMutex = Mutex<LockKind::Hook>;
+    using ClassMutex = Mutex<LockKind::Class>;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace jnivm {
+    // Methods and Fields with the same name and signature are distinct members if their kind differs
+    enum class MemberKind : std::uint8_t {
+        Instance,
+        Static,
+        // Only used by methods registered via RegisterNatives
+        Native
+    };
+
+    namespace impl {
+        // FNV-1a over name, signature and kind, computed without allocating a std::string
+        inline std::size_t HashMember(const char* name, std::size_t namelen, const char* sig, std::size_t siglen, MemberKind kind) {
+            std::uint64_t hash = 14695981039346656037ull;
+            auto update = [&hash](const char* str, std::size_t len) {
+                for(std::size_t i = 0; i < len; ++i) {
+                    hash = (hash ^ static_cast<unsigned char>(str[i])) * 1099511628211ull;
+                }
+                // Separator, to keep ("ab", "c") and ("a", "bc") apart
+                hash = (hash ^ 0xff) * 1099511628211ull;
+            };
+            update(name, namelen);
+            update(sig, siglen);
+            hash = (hash ^ static_cast<std::uint8_t>(kind)) * 1099511628211ull;
+            return static_cast<std::size_t>(hash);
+        }
+    }
+
+    // Hash index over Class::methods or Class::fields keyed by (name, signature, kind)
+    // T has to provide `name`, `GetSignature()` and `GetKind()`
+    // Not thread safe, guard it with Class::mtx like the member vectors it indexes
+    template<class T> class MemberIndex {
+        std::unordered_multimap<std::size_t, T*> index;
+
+        static bool Matches(const T* member, const char* name, std::size_t namelen, const char* sig, std::size_t siglen, MemberKind kind) {
+            auto&& msig = member->GetSignature();
+            return member->GetKind() == kind && member->name.size() == namelen && msig.size() == siglen && !memcmp(member->name.data(), name, namelen) && !memcmp(msig.data(), sig, siglen);
+        }
+    public:
+        T* Find(const char* name, std::size_t namelen, const char* sig, std::size_t siglen, MemberKind kind) const {
+            auto range = index.equal_range(impl::HashMember(name, namelen, sig, siglen, kind));
+            for(auto i = range.first; i != range.second; ++i) {
+                if(Matches(i->second, name, namelen, sig, siglen, kind)) {
+                    return i->second;
+                }
+            }
+            return nullptr;
+        }
+
+        T* Find(const char* name, const char* sig, MemberKind kind) const {
+            return Find(name ? name : "", name ? strlen(name) : 0, sig ? sig : "", sig ? strlen(sig) : 0, kind);
+        }
+
+        T* Find(const std::string& name, const std::string& sig, MemberKind kind) const {
+            return Find(name.data(), name.size(), sig.data(), sig.size(), kind);
+        }
+
+        // Name, signature and kind of member must not change while it is indexed
+        void Insert(T* member) {
+            auto&& sig = member->GetSignature();
+            index.emplace(impl::HashMember(member->name.data(), member->name.size(), sig.data(), sig.size(), member->GetKind()), member);
+        }
+
+        void Erase(T* member) {
+            auto&& sig = member->GetSignature();
+            auto range = index.equal_range(impl::HashMember(member->name.data(), member->name.size(), sig.data(), sig.size(), member->GetKind()));
+            for(auto i = range.first; i != range.second; ++i) {
+                if(i->second == member) {
+                    index.erase(i);
+                    return;
+                }
+            }
+        }
+
+        void Clear() {
+            index.clear();
+        }
+
+        std::size_t Size() const {
+            return index.size();
+        }
+    };
+}
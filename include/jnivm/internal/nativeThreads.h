@@ -0,0 +1,29 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jnivm {
+
+    // Native threads started on behalf of a VM, like the ones of java/lang/Thread
+    // Destroying it waits for all of them, so they never outlive the VM owning them
+    class NativeThreads {
+        struct Started {
+            std::thread thread;
+            std::shared_ptr<std::atomic<bool>> finished;
+        };
+        std::mutex mtx;
+        std::vector<Started> threads;
+    public:
+        NativeThreads() = default;
+        NativeThreads(const NativeThreads&) = delete;
+        NativeThreads& operator=(const NativeThreads&) = delete;
+        // Also joins threads started earlier and finished since, throws like std::thread if no thread can be created
+        void Start(std::function<void()> f);
+        // Joins every thread, including threads started by them while waiting
+        ~NativeThreads();
+    };
+}
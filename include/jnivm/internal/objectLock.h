@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace jnivm {
+
+    // Monitor of an object, a single word until the lock is contended, entered recursively or waited on
+    // Unlocked the word is 0, thin locked it holds a token of the owning thread, taking or releasing it is a single CAS
+    // Inflated it points to a monitor with its own mutex and condition variables, which lives as long as the object
+    // Copies are unlocked, like the lock of a new object
+    class ObjectLock {
+    public:
+        // Attempts to take a thin lock held by another thread, before inflating it
+        static constexpr int SpinCount = 16;
+
+        ObjectLock() = default;
+        ObjectLock(const ObjectLock&) : ObjectLock() {}
+        ObjectLock& operator=(const ObjectLock&) { return *this; }
+        ~ObjectLock();
+
+        // Blocks until the current thread owns the lock, may be entered recursively
+        void lock();
+        bool try_lock();
+        // Returns false if the current thread doesn't own the lock
+        bool unlock();
+
+        // Like Object.wait, releases the lock completely until notified or the timeout passed and takes it again
+        // A timeout of 0 waits forever, wakeups may be spurious. Returns false if the current thread doesn't own the lock
+        bool Wait(std::int64_t millis = 0);
+        // Like Object.notify and Object.notifyAll, returns false if the current thread doesn't own the lock
+        bool Notify();
+        bool NotifyAll();
+
+        bool IsHeldByCurrentThread() const;
+        bool IsInflated() const {
+            return word.load(std::memory_order_acquire) & Inflated;
+        }
+
+    private:
+        struct Monitor;
+        static constexpr std::uintptr_t Inflated = 1;
+
+        std::atomic<std::uintptr_t> word { 0 };
+
+        // Nonzero and even, unique among running threads
+        static std::uintptr_t Token();
+        // Replaces a thin lock with a monitor owned by the same thread, the monitor is published once
+        Monitor* Inflate();
+        // Spins and inflates after the first attempt found w instead of an unlocked word
+        // Returns true if the lock was held by another thread
+        bool LockSlow(std::uintptr_t token, std::uintptr_t w);
+        // Monitor of a lock held by the current thread, nullptr if it isn't the owner
+        Monitor* OwnedMonitor();
+    };
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace jnivm {
+
+    // Size class pool for short lived runtime objects of one ENV, like strings, arrays and reference wrappers
+    // Only the owning thread allocates, any thread may free. Frees of other threads are handed back via a lock free list
+    // Objects keep their pool alive through the allocator stored in their control block, so they may outlive the ENV
+    // Chunks are only released by Trim, so a burst keeps its peak memory until all objects allocated from the pool are gone
+    class ObjectPool : public std::enable_shared_from_this<ObjectPool> {
+    public:
+        static constexpr std::size_t Granularity = 16;
+        // Larger allocations use operator new
+        static constexpr std::size_t MaxSize = 256;
+        static constexpr std::size_t ChunkSize = 64 * 1024;
+
+        struct Stats {
+            std::size_t allocations;
+            std::size_t deallocations;
+            // Deallocations of other threads, included in deallocations
+            std::size_t remotefrees;
+            // Allocations larger than MaxSize
+            std::size_t oversized;
+            std::size_t chunks;
+        };
+
+        ObjectPool();
+        ~ObjectPool();
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        // Makes the current thread the owner, requires that nothing allocated from this pool is alive
+        // That is the case if this pool is only referenced by one shared_ptr, each allocation holds another
+        void Rebind() {
+            owner = std::this_thread::get_id();
+        }
+        bool IsOwner() const {
+            return std::this_thread::get_id() == owner;
+        }
+        // Releases every chunk but the newest and drops all free blocks, does nothing unless called by the owning thread
+        // Requires that nothing allocated from this pool is alive, see Rebind
+        void Trim();
+        // Requires the owning thread
+        void* Allocate(std::size_t size);
+        void Deallocate(void* p, std::size_t size);
+        // Exact on the owning thread
+        Stats GetStats() const;
+
+    private:
+        struct Block {
+            Block* next;
+        };
+        static constexpr std::size_t Classes = MaxSize / Granularity;
+
+        std::thread::id owner;
+        Block* freelists[Classes] = {};
+        std::atomic<Block*> remote[Classes];
+        // Unused rest of the newest chunk
+        char* cur = nullptr;
+        char* end = nullptr;
+        std::vector<void*> chunks;
+        std::size_t allocations = 0;
+        std::size_t deallocations = 0;
+        std::size_t oversized = 0;
+        std::atomic<std::size_t> remotefrees { 0 };
+
+        static std::size_t ClassOf(std::size_t size) {
+            return (size + Granularity - 1) / Granularity - 1;
+        }
+        void* Refill(std::size_t index);
+    };
+
+    // Allocator for std::allocate_shared backed by an ObjectPool
+    template<class T> class PoolAllocator {
+        template<class U> friend class PoolAllocator;
+        std::shared_ptr<ObjectPool> pool;
+    public:
+        using value_type = T;
+
+        PoolAllocator(std::shared_ptr<ObjectPool> pool) : pool(std::move(pool)) {}
+        template<class U> PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(pool->Allocate(n * sizeof(T)));
+        }
+        void deallocate(T* p, std::size_t n) {
+            pool->Deallocate(p, n * sizeof(T));
+        }
+
+        template<class U> bool operator==(const PoolAllocator<U>& other) const {
+            return pool == other.pool;
+        }
+        template<class U> bool operator!=(const PoolAllocator<U>& other) const {
+            return pool != other.pool;
+        }
+    };
+
+    // Allocates from pool on its owning thread, falls back to std::make_shared if pool is nullptr or owned by another thread
+    template<class T, class... Args> std::shared_ptr<T> MakeShared(ObjectPool* pool, Args&&... args) {
+        if(pool && pool->IsOwner()) {
+            return std::allocate_shared<T>(PoolAllocator<T>(pool->shared_from_this()), std::forward<Args>(args)...);
+        }
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+}
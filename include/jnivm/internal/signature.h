@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace jnivm {
+    // Parameter layout of a jni method signature, parsed once when a Method is created
+    struct MethodSignature {
+        // The jvm limits a method to 255 parameters
+        static constexpr std::size_t MaxParameters = 255;
+        // One jni type character per parameter, arrays are stored as 'L' like any other object
+        std::string parameters;
+        // First character of the return type, '[' and 'L' are kept apart
+        char returntype = 0;
+        // Offset of the return type inside the parsed signature
+        std::size_t returnoffset = 0;
+        // False for malformed signatures or more than MaxParameters parameters
+        bool valid = false;
+
+        MethodSignature() = default;
+        explicit MethodSignature(const std::string& signature);
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace jnivm {
+    class Object;
+    class Class;
+
+    // Return value of an object returning stub which can be reused by every call
+    struct StubValue {
+        // Shared empty array or dummy object
+        std::shared_ptr<Object> value;
+        // Class of the returned object, objects of native types are created per call via Class::Instantiate
+        // Weak, the class may own the method of this stub
+        std::weak_ptr<Class> clazz;
+    };
+
+    // Used by a Method or Field without a native implementation, only the counter is stored inline
+    struct Stub {
+        // Number of calls hitting this stub
+        std::atomic<std::size_t> calls { 0 };
+        // Owned, allocated by the first call returning an object
+        std::atomic<StubValue*> cached { nullptr };
+
+        Stub() = default;
+        // Copies start without a cached value
+        Stub(const Stub&) : Stub() {}
+        Stub& operator=(const Stub&) {
+            return *this;
+        }
+        ~Stub() {
+            delete cached.load(std::memory_order_acquire);
+        }
+    };
+}
@@ -7,6 +7,7 @@
 #include <jni.h>
 #include "array.h"
 #include <type_traits>
+#include <typeinfo>
 #include "internal/findclass.h"
 #include "cpp_void_t.h"
 
@@ -274,40 +275,35 @@ template<class T> struct ClassName<T, true> {
 #include "env.h"
 
 template<class T, class B, class orgtype> std::string jnivm::JNITypesObjectBase<T, B, orgtype>::GetJNISignature(jnivm::ENV *env){
-    std::lock_guard<std::mutex> lock(env->GetVM()->mtx);
-    auto r = env->GetVM()->typecheck.find(typeid(T));
-    if(r != env->GetVM()->typecheck.end()) {
-        return "L" + r->second->nativeprefix + ";";
+    if(auto r = env->GetVM()->FindType(typeid(T))) {
+        return "L" + r->nativeprefix + ";";
     } else {
         return "L" + ClassName<T, hasname<T>::value>::getClassName() + ";"; 
     }
 }
 
 template<class T, class B, class orgtype> std::shared_ptr<jnivm::Class> jnivm::JNITypesObjectBase<T, B, orgtype>::GetClass(jnivm::ENV *env) {
-    // ToDo find the deadlock or replace with recursive_mutex
-    // std::lock_guard<std::mutex> lock(env->GetVM()->mtx);
-    auto r = env->GetVM()->typecheck.find(typeid(T));
-    if(r != env->GetVM()->typecheck.end()) {
-        return r->second;
-    } else {
-        return nullptr;
-    }
+    return env->GetVM()->FindType(typeid(T));
 }
 
 template<class T, class B, class orgtype> template<class Y> B jnivm::JNITypesObjectBase<T, B, orgtype>::ToJNIType(jnivm::ENV *env, const std::shared_ptr<Y> &p) {
     if(!p) return nullptr;
     // Cache return values in localframe list of this thread, destroy delayed
     
-    std::shared_ptr<Object> obj(p, p.get());
+    Object* obj = p.get();
     if(obj) {
-        auto clazz = obj->clazz.lock();
-        if(!clazz) {
+        // Doesn't write to the control block of the class, unlike lock
+        // Classes are shared by all threads, FindClass sets their class once before publishing them
+        if(obj->kind != ObjectKind::Class && obj->clazz.expired()) {
             obj->clazz = JNITypesObjectBase<Y, B>::GetClass(env);
         }
-        auto ref = (B)obj.get();
-        env->localframe.front().push_back(std::move(obj));
+        if(obj->pinned.owner) {
+            env->localrefs.AddPinned(obj);
+        } else {
+            env->localrefs.Add(std::shared_ptr<Object>(p, obj));
+        }
         // Return jni Reference
-        return ref;
+        return (B)obj;
     } else {
         throw std::runtime_error("Failed Convert Object to JNI");
     }
@@ -316,22 +312,54 @@ template<class T, class B, class orgtype> template<class Y> B jnivm::JNITypesObj
 #include "class.h"
 #include "weak.h"
 
+namespace jnivm {
+    namespace impl {
+        // Casts obj to T, remembers the offset of the last dynamic type seen by this thread
+        // Objects of one type have the same layout, so dynamic_cast only runs if the dynamic type changes
+        template<class T> struct CachedCast {
+            static T* Cast(Object* obj) {
+                struct Entry {
+                    const std::type_info* type;
+                    std::ptrdiff_t offset;
+                    bool match;
+                };
+                static thread_local Entry last = { nullptr, 0, false };
+                auto&& cur = typeid(*obj);
+                if(&cur != last.type) {
+                    auto ret = dynamic_cast<T*>(obj);
+                    last.type = &cur;
+                    last.match = ret != nullptr;
+                    last.offset = last.match ? reinterpret_cast<const char*>(ret) - reinterpret_cast<const char*>(obj) : 0;
+                    return ret;
+                }
+                return last.match ? reinterpret_cast<T*>(reinterpret_cast<char*>(obj) + last.offset) : nullptr;
+            }
+        };
+        template<> struct CachedCast<Object> {
+            static Object* Cast(Object* obj) {
+                return obj;
+            }
+        };
+    }
+}
+
 template<class T> static std::shared_ptr<T> UnpackJObject(jnivm::Object* obj) {
     if(!obj) return nullptr;
-    auto weak = dynamic_cast<jnivm::Weak*>(obj);
-    if(weak != nullptr) {
-        auto obj = weak->wrapped.lock();
-        if(obj) {
-            return UnpackJObject<T>(obj.get());
+    switch(obj->kind) {
+    case jnivm::ObjectKind::Weak: {
+        auto target = jnivm::impl::CachedCast<jnivm::Weak>::Cast(obj)->Get();
+        if(target) {
+            return UnpackJObject<T>(target.get());
         } else {
             return nullptr;
         }
     }
-    auto global = dynamic_cast<jnivm::Global*>(obj);
-    if(global != nullptr) {
-        return UnpackJObject<T>(global->wrapped.get());
+    case jnivm::ObjectKind::Global:
+        return UnpackJObject<T>(jnivm::impl::CachedCast<jnivm::Global>::Cast(obj)->wrapped.get());
+    default:
+        break;
     }
-    auto ret = dynamic_cast<T*>(obj);
+    auto ret = jnivm::impl::CachedCast<T>::Cast(obj);
     if(ret != nullptr) {
         return std::shared_ptr<T>(ret->shared_from_this(), ret);
     }
@@ -339,8 +367,8 @@ template<class T> static std::shared_ptr<T> UnpackJObject(jnivm::Object* obj) {
 }
 template<> std::shared_ptr<jnivm::Weak> UnpackJObject<jnivm::Weak>(jnivm::Object* obj) {
     if(!obj) return nullptr;
-    auto ret = dynamic_cast<jnivm::Weak*>(obj);
-    if(ret != nullptr) {
+    if(obj->kind == jnivm::ObjectKind::Weak) {
+        auto ret = jnivm::impl::CachedCast<jnivm::Weak>::Cast(obj);
         return std::shared_ptr<jnivm::Weak>(ret->shared_from_this(), ret);
     } else {
         throw std::runtime_error("Invalid Reference, not a WeakGlobal Reference");
@@ -348,8 +376,8 @@ template<> std::shared_ptr<jnivm::Weak> UnpackJObject<jnivm::Weak>(jnivm::Object
 }
 template<> std::shared_ptr<jnivm::Global> UnpackJObject<jnivm::Global>(jnivm::Object* obj) {
     if(!obj) return nullptr;
-    auto ret = dynamic_cast<jnivm::Global*>(obj);
-    if(ret != nullptr) {
+    if(obj->kind == jnivm::ObjectKind::Global) {
+        auto ret = jnivm::impl::CachedCast<jnivm::Global>::Cast(obj);
         return std::shared_ptr<jnivm::Global>(ret->shared_from_this(), ret);
     } else {
         throw std::runtime_error("Invalid Reference, not a Global Reference");
@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace jnivm {
+    // Contention of one kind of lock, summed over all its instances, see VM::GetLockProfile
+    struct LockProfile {
+        // Bucket 0 counts waits below 1us, bucket i waits below 2^i us, the last one every longer wait
+        static constexpr std::size_t Buckets = 16;
+
+        // Acquisitions made while a JNI function was running on the same thread
+        struct Callsite {
+            // JNI function called by native code, "(outside JNI)" for the jnivm API and hooks called by JNI functions
+            std::string name;
+            std::uint64_t acquisitions = 0;
+            std::uint64_t contended = 0;
+            std::uint64_t waitns = 0;
+        };
+
+        std::string name;
+        std::uint64_t acquisitions = 0;
+        // Acquisitions which had to wait for another thread
+        std::uint64_t contended = 0;
+        // Total and longest time spent waiting
+        std::uint64_t waitns = 0;
+        std::uint64_t maxwaitns = 0;
+        // Wait time of every acquisition, uncontended ones are counted in bucket 0
+        std::array<std::uint64_t, Buckets> histogram {};
+        // Sorted by waitns, highest first
+        std::vector<Callsite> callsites;
+    };
+}
@@ -3,9 +3,13 @@
 #include "object.h"
 #include <string>
 #include <stdexcept>
+#include <cstring>
 #include <jni.h>
 
 #include "methodhandlebase.h"
+#include "internal/memberIndex.h"
+#include "internal/signature.h"
+#include "internal/stub.h"
 
 namespace jnivm {
     class Class;
@@ -16,12 +20,47 @@ namespace jnivm {
         jvalue jinvoke(ENV& env, jobject obj, jvalue*);
         template<class T, class... param>
         jvalue j2invoke(JNIEnv& env, T clorObj, param... params);
+        template<class R, class T, class... param>
+        R j3invoke(JNIEnv& env, T clorObj, param... params);
+        friend class Executor;
     public:
         std::string name;
         std::string signature;
         bool _static = false;
+        // Set if the hook may run on multiple threads at once, allows ENV::CallMethodBatch to split calls across threads
+        bool threadsafe = false;
         void* native = nullptr;
         std::shared_ptr<MethodHandle> nativehandle;
+        // Parsed form of signature, only valid if created by the constructor taking a signature
+        MethodSignature parsedsignature;
+        // Used if nativehandle and native are not set
+        Stub stub;
+
+        Method() = default;
+        Method(std::string name, std::string signature, bool _static = false, void* native = nullptr) : name(std::move(name)), signature(std::move(signature)), _static(_static), native(native), parsedsignature(this->signature) {}
+
+        MemberKind GetKind() const {
+            return native ? MemberKind::Native : _static ? MemberKind::Static : MemberKind::Instance;
+        }
+        const std::string& GetSignature() const {
+            return signature;
+        }
+        // Return type part of signature like "I" or "Ljava/lang/String;", nullptr if the signature is malformed
+        const char* GetReturnType() const {
+            if(parsedsignature.valid) {
+                return signature.data() + parsedsignature.returnoffset;
+            }
+            auto off = signature.find_last_of(')');
+            return off != std::string::npos && off + 1 < signature.size() ? signature.data() + off + 1 : nullptr;
+        }
+        // First character of the return type or 0
+        char GetReturnKind() const {
+            if(parsedsignature.valid) {
+                return parsedsignature.returntype;
+            }
+            auto type = GetReturnType();
+            return type ? *type : 0;
+        }
 
 #ifdef JNI_DEBUG
         std::string GenerateHeader(const std::string &cname);
@@ -32,6 +71,12 @@ namespace jnivm {
         jvalue invoke(JNIEnv& env, jnivm::Class* cl, param... params);
         template<class... param>
         jvalue invoke(JNIEnv& env, jnivm::Object* obj, param... params);
+        // Typed variant of invoke, R has to be a jni type like jint, jobject or void and match the signature
+        // Methods registered via RegisterNatives are called directly without boxing the parameters into jvalues
+        template<class R, class... param>
+        R invokeAs(JNIEnv& env, jnivm::Class* cl, param... params);
+        template<class R, class... param>
+        R invokeAs(JNIEnv& env, jnivm::Object* obj, param... params);
     };
 
     class MethodProxy {
@@ -96,8 +141,7 @@ namespace jnivm {
 template<class T, class... param> jvalue jnivm::Method::j2invoke(JNIEnv &env, T cl, param ...params) {
     jvalue ret;
     if(native) {
-        auto type = signature[signature.find_last_of(')') + 1];
-        switch (type) {
+        switch (GetReturnKind()) {
         case 'V':
             ((void(*)(JNIEnv*, T, impl::JNINativeMethodHelper<param>...))native)(&env, cl, JNITypes<param>::ToJNIReturnType(ENV::FromJNIEnv(&env), params)...);
             ret = {};
@@ -143,6 +187,113 @@ template<class T, class... param> jvalue jnivm::Method::j2invoke(JNIEnv &env, T
     return ret;
 }
 
+namespace jnivm {
+    namespace impl {
+        template<class R> struct NativeReturn {
+            static bool Matches(char type) {
+                static_assert(std::is_convertible<R, jobject>::value, "Unsupported return type, use a jni type");
+                return type == 'L' || type == '[';
+            }
+            template<class F, class... param> static R Call(JNIEnv& env, F f, param... params) {
+                R ret = f(&env, params...);
+                if((ENV::FromJNIEnv(&env))->current_exception) {
+                    std::rethrow_exception((ENV::FromJNIEnv(&env))->current_exception->except);
+                }
+                return ret;
+            }
+            static R FromJValue(const jvalue& v) {
+                return (R)v.l;
+            }
+        };
+        template<> struct NativeReturn<void> {
+            static bool Matches(char type) {
+                return type == 'V';
+            }
+            template<class F, class... param> static void Call(JNIEnv& env, F f, param... params) {
+                f(&env, params...);
+                if((ENV::FromJNIEnv(&env))->current_exception) {
+                    std::rethrow_exception((ENV::FromJNIEnv(&env))->current_exception->except);
+                }
+            }
+            static void FromJValue(const jvalue& v) {
+            }
+        };
+#define DeclarePrimitiveNativeReturn(R, T, member) template<> struct NativeReturn<R> { \
+            static bool Matches(char type) { \
+                return type == T; \
+            } \
+            template<class F, class... param> static R Call(JNIEnv& env, F f, param... params) { \
+                R ret = f(&env, params...); \
+                if((ENV::FromJNIEnv(&env))->current_exception) { \
+                    std::rethrow_exception((ENV::FromJNIEnv(&env))->current_exception->except); \
+                } \
+                return ret; \
+            } \
+            static R FromJValue(const jvalue& v) { \
+                return v.member; \
+            } \
+        }
+        DeclarePrimitiveNativeReturn(jboolean, 'Z', z);
+        DeclarePrimitiveNativeReturn(jbyte, 'B', b);
+        DeclarePrimitiveNativeReturn(jshort, 'S', s);
+        DeclarePrimitiveNativeReturn(jchar, 'C', c);
+        DeclarePrimitiveNativeReturn(jint, 'I', i);
+        DeclarePrimitiveNativeReturn(jlong, 'J', j);
+        DeclarePrimitiveNativeReturn(jfloat, 'F', f);
+        DeclarePrimitiveNativeReturn(jdouble, 'D', d);
+#undef DeclarePrimitiveNativeReturn
+
+        // Jni type character of a parameter like in MethodSignature::parameters, 0 if T isn't a jni type
+        template<class T> struct NativeParameter {
+            static constexpr char kind = std::is_convertible<T, jobject>::value ? 'L' : 0;
+        };
+#define DeclarePrimitiveNativeParameter(T, K) template<> struct NativeParameter<T> { \
+            static constexpr char kind = K; \
+        }
+        DeclarePrimitiveNativeParameter(jboolean, 'Z');
+        DeclarePrimitiveNativeParameter(jbyte, 'B');
+        DeclarePrimitiveNativeParameter(jshort, 'S');
+        DeclarePrimitiveNativeParameter(jchar, 'C');
+        DeclarePrimitiveNativeParameter(jint, 'I');
+        DeclarePrimitiveNativeParameter(jlong, 'J');
+        DeclarePrimitiveNativeParameter(jfloat, 'F');
+        DeclarePrimitiveNativeParameter(jdouble, 'D');
+#undef DeclarePrimitiveNativeParameter
+
+        // Parameter kinds of one instantiation, computed at compile time and compared with the parsed signature per call
+        template<class... param> struct NativeParameters {
+            static constexpr char kinds[sizeof...(param) + 1] = { NativeParameter<param>::kind..., 0 };
+            static bool Matches(const MethodSignature& signature) {
+                return signature.valid && signature.parameters.size() == sizeof...(param) && !memcmp(signature.parameters.data(), kinds, sizeof...(param));
+            }
+        };
+        template<class... param> constexpr char NativeParameters<param...>::kinds[];
+    }
+}
+
+template<class R, class T, class... param> R jnivm::Method::j3invoke(JNIEnv &env, T clorObj, param ...params) {
+    if(!impl::NativeReturn<R>::Matches(GetReturnKind())) {
+        throw std::runtime_error("Mismatched return type of signature " + signature);
+    }
+    // Both paths read exactly as many parameters as the signature has, without converting between types
+    if(!impl::NativeParameters<impl::JNINativeMethodHelper<param>...>::Matches(parsedsignature)) {
+        throw std::runtime_error("Mismatched parameter types of signature " + signature);
+    }
+    if(native) {
+        return impl::NativeReturn<R>::Call(env, (R(*)(JNIEnv*, T, impl::JNINativeMethodHelper<param>...))native, clorObj, JNITypes<param>::ToJNIReturnType(ENV::FromJNIEnv(&env), params)...);
+    }
+    return impl::NativeReturn<R>::FromJValue(j2invoke<T>(env, clorObj, params...));
+}
+
+template<class R, class... param> R jnivm::Method::invokeAs(JNIEnv &env, jnivm::Class* cl, param ...params) {
+    // The caller keeps cl alive, so it can be passed without creating a local reference
+    return j3invoke<R, jclass>(env, (jclass)cl, params...);
+}
+
+template<class R, class... param> R jnivm::Method::invokeAs(JNIEnv &env, jnivm::Object* obj, param ...params) {
+    return j3invoke<R, jobject>(env, (jobject)obj, params...);
+}
+
 template<class... param> jvalue jnivm::Method::invoke(JNIEnv &env, jnivm::Class* cl, param ...params) {
     return j2invoke<jclass>(env, JNITypes<jclass>::ToJNIType(ENV::FromJNIEnv(&env), std::shared_ptr<Class>(cl->shared_from_this(), cl)), params...);
 }
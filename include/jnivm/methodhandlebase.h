@@ -1,5 +1,6 @@
 #pragma once
 #include <jni.h>
+#include <cstdint>
 #include <stdexcept>
 
 namespace jnivm {
@@ -7,39 +8,107 @@ namespace jnivm {
     class ENV;
 
     namespace impl {
-        template<class T> class MethodHandleBase {
-        public:
-            virtual T InstanceInvoke(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<T>) {
-                throw std::runtime_error("Mismatched MethodHandle!");
-            }
-            virtual T InstanceGet(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<T>) {
-                throw std::runtime_error("Mismatched MethodHandle!");
-            }
-            virtual T NonVirtualInstanceInvoke(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<T>) {
-                throw std::runtime_error("Mismatched MethodHandle!");
-            }
-            virtual T NonVirtualInstanceGet(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<T>) {
-                throw std::runtime_error("Mismatched MethodHandle!");
-            }
-            virtual T StaticInvoke(ENV * env, Class* clazz, const jvalue* values, MethodHandleBase<T>) {
-                throw std::runtime_error("Mismatched MethodHandle!");
-            }
-            virtual T StaticGet(ENV * env, Class* clazz, const jvalue* values, MethodHandleBase<T>) {
-                throw std::runtime_error("Mismatched MethodHandle!");
-            }
-            virtual void InstanceSet(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<T>) {
+        // JNI value type a MethodHandle entry returns (or accepts for setters)
+        enum class HandleType : std::uint8_t {
+            None,
+            Object,
+            Boolean,
+            Byte,
+            Char,
+            Short,
+            Int,
+            Long,
+            Float,
+            Double,
+            Void
+        };
+
+        template<class T> struct HandleTypeOf;
+#define DeclareHandleType(type, value) template<> struct HandleTypeOf<type> { static constexpr HandleType Value = HandleType::value; };
+        DeclareHandleType(jobject, Object)
+        DeclareHandleType(jboolean, Boolean)
+        DeclareHandleType(jbyte, Byte)
+        DeclareHandleType(jchar, Char)
+        DeclareHandleType(jshort, Short)
+        DeclareHandleType(jint, Int)
+        DeclareHandleType(jlong, Long)
+        DeclareHandleType(jfloat, Float)
+        DeclareHandleType(jdouble, Double)
+        DeclareHandleType(void, Void)
+#undef DeclareHandleType
+
+        enum class HandleKind : std::uint8_t {
+            InstanceInvoke,
+            NonVirtualInstanceInvoke,
+            StaticInvoke,
+            InstanceGet,
+            StaticGet,
+            InstanceSet,
+            StaticSet,
+            Count
+        };
+    }
+
+    // Flat call table of a hooked Method or Field, one thunk per call kind sharing a single context
+    // Thunks are plain function pointers `R(*)(void* context, ENV*, jobject or Class*, const jvalue*)`,
+    // calling one is a type check and an indirect call without any virtual dispatch
+    class MethodHandle {
+        using Thunk = void(*)();
+        Thunk thunks[static_cast<std::size_t>(impl::HandleKind::Count)] = {};
+        impl::HandleType types[static_cast<std::size_t>(impl::HandleKind::Count)] = {};
+        void* context = nullptr;
+
+        template<class T, class O> T Call(impl::HandleKind kind, ENV * env, O obj, const jvalue* values) const {
+            auto i = static_cast<std::size_t>(kind);
+            if(types[i] != impl::HandleTypeOf<T>::Value) {
                 throw std::runtime_error("Mismatched MethodHandle!");
             }
-            virtual void StaticSet(ENV * env, Class* clazz, const jvalue* values, MethodHandleBase<T>) {
+            return reinterpret_cast<T(*)(void*, ENV*, O, const jvalue*)>(thunks[i])(context, env, obj, values);
+        }
+
+        template<class T, class O> void CallSetter(impl::HandleKind kind, ENV * env, O obj, const jvalue* values) const {
+            auto i = static_cast<std::size_t>(kind);
+            if(types[i] != impl::HandleTypeOf<T>::Value) {
                 throw std::runtime_error("Mismatched MethodHandle!");
             }
-        };
+            reinterpret_cast<void(*)(void*, ENV*, O, const jvalue*)>(thunks[i])(context, env, obj, values);
+        }
 
-        template<class...T>
-        class MethodHandle : public MethodHandleBase<T>... {
-        public:
+    protected:
+        // context is passed unchanged to every thunk, it has to outlive this handle
+        MethodHandle(void* context) : context(context) {}
 
-        };
-    }
-    using MethodHandle = impl::MethodHandle<jobject, jboolean, jbyte, jchar, jshort, jint, jlong, jfloat, jdouble, void>;
+        // type is the return type of invokers and getters, the value type of setters
+        template<class T, class R, class O> void SetThunk(impl::HandleKind kind, R(*thunk)(void*, ENV*, O, const jvalue*)) {
+            thunks[static_cast<std::size_t>(kind)] = reinterpret_cast<Thunk>(thunk);
+            types[static_cast<std::size_t>(kind)] = impl::HandleTypeOf<T>::Value;
+        }
+
+    public:
+        // The context usually points into the derived object
+        MethodHandle(const MethodHandle&) = delete;
+        MethodHandle& operator=(const MethodHandle&) = delete;
+
+        template<class T> T InstanceInvoke(ENV * env, jobject obj, const jvalue* values) const {
+            return Call<T>(impl::HandleKind::InstanceInvoke, env, obj, values);
+        }
+        template<class T> T NonVirtualInstanceInvoke(ENV * env, jobject obj, const jvalue* values) const {
+            return Call<T>(impl::HandleKind::NonVirtualInstanceInvoke, env, obj, values);
+        }
+        template<class T> T StaticInvoke(ENV * env, Class* clazz, const jvalue* values) const {
+            return Call<T>(impl::HandleKind::StaticInvoke, env, clazz, values);
+        }
+        template<class T> T InstanceGet(ENV * env, jobject obj, const jvalue* values) const {
+            return Call<T>(impl::HandleKind::InstanceGet, env, obj, values);
+        }
+        template<class T> T StaticGet(ENV * env, Class* clazz, const jvalue* values) const {
+            return Call<T>(impl::HandleKind::StaticGet, env, clazz, values);
+        }
+        template<class T> void InstanceSet(ENV * env, jobject obj, const jvalue* values) const {
+            CallSetter<T>(impl::HandleKind::InstanceSet, env, obj, values);
+        }
+        template<class T> void StaticSet(ENV * env, Class* clazz, const jvalue* values) const {
+            CallSetter<T>(impl::HandleKind::StaticSet, env, clazz, values);
+        }
+    };
 }
\ No newline at end of file
@@ -1,31 +1,76 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <vector>
 #include <unordered_map>
 #include <typeindex>
 #include "arrayBase.h"
+#include "internal/objectLock.h"
 
 namespace jnivm {
     class Class;
     class ENV;
-    struct ObjectMutexWrapper {
-        ObjectMutexWrapper() = default;
-        ObjectMutexWrapper(const ObjectMutexWrapper& other) : ObjectMutexWrapper() {}
-        ObjectMutexWrapper(ObjectMutexWrapper&& other) : ObjectMutexWrapper() {}
-        std::recursive_mutex lock;
-        jnivm::ObjectMutexWrapper &operator =(const jnivm::ObjectMutexWrapper &) { return *this; }
-        jnivm::ObjectMutexWrapper &operator =(jnivm::ObjectMutexWrapper &&) { return *this; }
+
+    // Copies of a pinned object are not pinned
+    struct ObjectPinnedWrapper {
+        ObjectPinnedWrapper() = default;
+        ObjectPinnedWrapper(const ObjectPinnedWrapper& other) : ObjectPinnedWrapper() {}
+        ObjectPinnedWrapper(ObjectPinnedWrapper&& other) : ObjectPinnedWrapper() {}
+        // VM::GetId of the VM keeping the object alive, 0 if it isn't pinned
+        std::uint64_t owner = 0;
+        jnivm::ObjectPinnedWrapper &operator =(const jnivm::ObjectPinnedWrapper &) { return *this; }
+        jnivm::ObjectPinnedWrapper &operator =(jnivm::ObjectPinnedWrapper &&) { return *this; }
+    };
+
+    // Builtin type of an object, checked with a branch instead of dynamic_cast
+    // Set by the constructors of the builtin types, any other object is an Object
+    enum class ObjectKind : std::uint8_t {
+        Object,
+        Global,
+        Weak,
+        String,
+        Array,
+        Class
+    };
+
+    // Weak reference to the class of an object
+    // Classes pinned by their VM are also kept as plain pointer, reading them via the same VM doesn't lock the weak_ptr
+    class ClassRef {
+        std::weak_ptr<Class> ref;
+        Class* pinned = nullptr;
+    public:
+        ClassRef() = default;
+        ClassRef(const std::shared_ptr<Class>& clazz);
+        ClassRef& operator=(const std::shared_ptr<Class>& clazz);
+        ClassRef& operator=(const std::weak_ptr<Class>& clazz);
+
+        std::shared_ptr<Class> lock() const {
+            return ref.lock();
+        }
+        bool expired() const {
+            return ref.expired();
+        }
+        // Pinned class if the VM of env owns it, which keeps it alive while env is used, otherwise nullptr
+        Class* get(ENV* env) const;
     };
 
     class Object : public std::enable_shared_from_this<Object> {
     public:
-        std::weak_ptr<Class> clazz;
+        ClassRef clazz;
         template<class T>
         using ArrayBaseType = impl::ArrayBase<T, Object>;
-        ObjectMutexWrapper lock;
+        // Monitor used by MonitorEnter, MonitorExit and the hooks of Object.wait, notify and notifyAll
+        ObjectLock lock;
+        // Set for objects the VM keeps alive until it is destroyed, like classes or objects passed to VM::Pin
+        // Local references to pinned objects don't touch the reference count
+        ObjectPinnedWrapper pinned;
+        ObjectKind kind = ObjectKind::Object;
 
         virtual std::shared_ptr<Class> getClassInternal(ENV* env);
+        // Class without taking ownership if the VM of env owns it, otherwise owner keeps it alive until the caller is done
+        // Overrides of getClassInternal have to override this as well
+        virtual Class* getClassBorrowed(ENV* env, std::shared_ptr<Class>& owner);
 
         Class& getClass();
 
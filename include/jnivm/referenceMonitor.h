@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+namespace jnivm {
+    class ENV;
+
+    enum class ReferenceKind {
+        Local,
+        // Global and weak global references
+        Global
+    };
+
+    // Thresholds of the reference accounting, see VM::SetReferenceMonitor
+    // A threshold of 0 disables the check, after a report the next one needs twice as many references
+    struct ReferenceMonitor {
+        // Live local references of one thread
+        std::size_t locals = 0;
+        // Global and weak global references of the VM, compared to GlobalReferenceTable::Peak
+        std::size_t globals = 0;
+        // Called on the thread creating the reference, env is nullptr for globals. Logs a warning if empty
+        std::function<void(ENV* env, ReferenceKind kind, std::size_t count)> callback;
+    };
+}
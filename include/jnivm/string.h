@@ -5,9 +5,15 @@
 namespace jnivm {
     class String : public Object, public std::string {
     public:
-        String() : std::string() {}
-        String(const std::string & str) : std::string(std::move(str)) {}
-        String(std::string && str) : std::string(std::move(str)) {}
+        String() : std::string() {
+            kind = ObjectKind::String;
+        }
+        String(const std::string & str) : std::string(std::move(str)) {
+            kind = ObjectKind::String;
+        }
+        String(std::string && str) : std::string(std::move(str)) {
+            kind = ObjectKind::String;
+        }
         inline std::string asStdString() {
             return *this;
         }
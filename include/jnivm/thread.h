@@ -0,0 +1,41 @@
+#pragma once
+#include <jnivm/object.h>
+#include <jnivm/extends.h>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace jnivm {
+    // java/lang/Runnable, run is dispatched like any other method, hook it on the class of the implementation
+    class Runnable : public Extends<Object> {
+    };
+
+    // java/lang/Thread, every started thread runs on its own native thread with an attached ENV
+    // The ENV comes from the pool of the VM, so starting a thread doesn't create a new ENV in most cases
+    // A running thread keeps its object alive, destroying the VM waits until all its threads have finished
+    class Thread : public Extends<Object, Runnable> {
+    public:
+        // Called by run unless a subclass overrides it, any object with a run method
+        std::shared_ptr<Object> target;
+
+        // Calls run on a new native thread, throws if the thread has already been started
+        void Start(ENV* env);
+        // Calls run of target
+        void Run(ENV* env);
+        // Blocks until the thread has finished or millis passed, 0 waits forever. Returns false on timeout
+        // Returns immediately if the thread has never been started, like Java
+        bool Join(std::int64_t millis = 0);
+        bool IsAlive();
+
+    private:
+        enum class State {
+            New,
+            Running,
+            Terminated
+        };
+        std::mutex mtx;
+        std::condition_variable finished;
+        State state = State::New;
+    };
+}
@@ -1,12 +1,21 @@
 #ifndef JNIVM_VM_H_1
 #define JNIVM_VM_H_1
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <vector>
 #include <unordered_map>
 #include <typeindex>
 #include <functional>
 #include <jni.h>
+#include <jnivm/internal/globalReferenceTable.h>
+#include <jnivm/internal/classIndex.h>
+#include <jnivm/internal/lockProfiler.h>
+#include <jnivm/internal/nativeThreads.h>
+#include <jnivm/executor.h>
+#include <jnivm/referenceMonitor.h>
+#include <atomic>
 #ifdef JNI_DEBUG
 #include <jnivm/internal/codegen/namespace.h>
 #endif
@@ -39,32 +48,87 @@ namespace jnivm {
         // Native Interface base Invocation Table
         JNINativeInterface ninterface;
         // Map of all jni threads and local stuff by thread id
+        // Guarded by envmtx, each thread caches its own entry, see GetEnv
         std::unordered_map<pthread_t, std::shared_ptr<ENV>> jnienvs;
+        EnvMutex envmtx;
+        // Unique for the whole process, a VM at the address of a destroyed one doesn't hit its cached ENVs
+        const std::uint64_t id = NextId();
+        static std::uint64_t NextId();
+        // Entry of the current thread in jnienvs, see GetEnv
+        std::shared_ptr<ENV>& CurrentEnv();
+        // Drops the cached ENV of the current thread, requires envmtx
+        void ForgetEnv();
+        // Detached ENVs created by VM::CreateEnv, reset and ready for the next thread, guarded by envmtx
+        std::vector<std::shared_ptr<ENV>> envpool;
+        // Reuses a pooled ENV or calls CreateEnv, for the current thread
+        std::shared_ptr<ENV> AttachEnv();
+        // Resets a pooled ENV of a detached thread and returns it to envpool
+        void DetachEnv(std::shared_ptr<ENV> env);
     protected:
         void OverrideJNIInvokeInterface(const JNIInvokeInterface& iinterface);
         // If you override this, you have to use the contructor with skipInit=true and call VM::initialize in your derived Class
         virtual std::shared_ptr<ENV> CreateEnv();
         const JNINativeInterface& GetNativeInterfaceTemplate();
+        // The native interface template with all jnienvhooks applied, rebuilt once they changed
+        JNINativeInterface GetHookedInterface();
         std::vector<std::function<void(JNINativeInterface&)>> jnienvhooks;
+    private:
+        // Guards jnienvhooks while the interface is rebuilt and the cache below
+        HookMutex hookmtx;
+        JNINativeInterface hookedinterface;
+        // Number of jnienvhooks applied to hookedinterface, SIZE_MAX forces a rebuild
+        std::size_t hookedcount = SIZE_MAX;
+        // Changes with every rebuild, pooled ENVs of an older version are updated once they are reused
+        std::uint64_t interfaceversion = 0;
+        // Applies jnienvhooks if needed, requires hookmtx
+        void UpdateHookedInterface();
+        // Guards pinned
+        PinnedMutex pinnedmtx;
+        std::mutex monitormtx;
+        ReferenceMonitor monitor;
+        // Global references needed for the next report
+        std::size_t nextglobalreport = 0;
     public:
+        // Thresholds of the current monitor, read without taking monitormtx
+        std::atomic<std::size_t> localthreshold { 0 };
+        std::atomic<std::size_t> globalthreshold { 0 };
+
         template<bool ReturnNull>
         static JNINativeInterface GetNativeInterfaceTemplate();
 
-        void AddHook(std::function<void(JNINativeInterface&)>&& hook) {
-            jnienvhooks.emplace_back(std::move(hook));
-        }
+        // Applies to ENVs created or reused after this call
+        void AddHook(std::function<void(JNINativeInterface&)>&& hook);
+
+        // Default of envpoolsize
+        static constexpr std::size_t DefaultEnvPoolSize = 16;
+        // Detached ENVs kept for reuse by the next AttachCurrentThread, only ENVs created by VM::CreateEnv are pooled
+        std::atomic<std::size_t> envpoolsize { DefaultEnvPoolSize };
 #ifdef JNI_DEBUG
         // For Generating Stub header files out of captured jni usage
         Namespace np;
 #endif
-        // Map of all classes hooked or implicitly declared
+        // Map of all classes hooked or implicitly declared, guarded by classesmtx
+        // Entries are never erased, FindClass publishes every entry to classindex
         std::unordered_map<std::string, std::shared_ptr<Class>> classes;
-
-        std::mutex mtx;
-        // Stores all global references
-        std::vector<std::shared_ptr<Object>> globals;
-        // Stores all classes by c++ typeid
+        // Lock free index of classes, only declaring a new class takes classesmtx
+        ClassIndex classindex;
+        // Readers of classes take it shared, declaring a new class takes it exclusive
+        ClassesMutex classesmtx;
+        // Stores all global and weak global references, synchronizes itself
+        GlobalReferenceTable globals;
+        // Objects kept alive until the VM is destroyed, see Pin
+        std::vector<std::shared_ptr<Object>> pinned;
+        // Classes of the wrappers created by NewGlobalRef and NewWeakGlobalRef, set by initialize
+        std::shared_ptr<Class> globalclass;
+        std::shared_ptr<Class> weakclass;
+        // Stores all classes by c++ typeid, guarded by typecheckmtx, prefer FindType for lookups
         std::unordered_map<std::type_index, std::shared_ptr<Class>> typecheck;
+        // Lookups take it shared, only ENV::GetClass<T> takes it exclusive
+        TypeCheckMutex typecheckmtx;
+        // Bumped by Class::InvalidateVTables, every class of this VM drops its vtable once it sees a new revision
+        std::atomic<std::size_t> vtablerevision { 1 };
+        // Returns the class registered for type by ENV::GetClass<T>, nullptr if there is none
+        std::shared_ptr<Class> FindType(const std::type_index& type);
         VM(const VM&) = delete;
         VM(VM&&) = delete;
         // Initialize the native VM instance
@@ -76,11 +140,49 @@ namespace jnivm {
         JavaVM * GetJavaVM();
         // Returns the jni JNIEnv of the current thread
         JNIEnv * GetJNIEnv();
-        // Returns the Env of the current thread
+        // Returns the Env of the current thread, empty if the thread isn't attached
+        // Lock free once the thread called it before, until it detaches
         const std::shared_ptr<ENV>& GetEnv();
 
         static VM* FromJavaVM(JavaVM * env);
 
+        // Unique for the whole process, identifies the VM owning a pinned object
+        std::uint64_t GetId() const {
+            return id;
+        }
+        // Keeps obj alive until this VM is destroyed, local references to it skip the atomic reference counting
+        // Call it before obj is shared with other threads and don't use obj with VMs outliving this one
+        void Pin(const std::shared_ptr<Object>& obj);
+
+        // Slots of VM::globals swept by every DetachCurrentThread
+        static constexpr std::size_t SweepPerDetach = 64;
+        // Releases the control blocks of all destroyed targets of weak global references, returns their number
+        // Weak references are also swept incrementally by NewWeakGlobalRef and DetachCurrentThread, see globals.Weaks() for counters
+        std::size_t CollectWeak();
+
+        // Reports threads and the VM exceeding the reference thresholds of monitor, replaces the previous monitor
+        // Counters are available via ENV::localrefs.GetStats() per thread and globals.Size(), globals.Peak() and globals.Weaks()
+        void SetReferenceMonitor(ReferenceMonitor monitor);
+        // Calls the callback of the monitor or logs a warning
+        void ReportReferences(ENV* env, ReferenceKind kind, std::size_t count);
+
+        // Workers started by the first GetExecutor call, 0 uses the number of hardware threads
+        std::atomic<std::size_t> executorthreads { 0 };
+        // Creates the executor on first use, it is stopped after the threads of StartThread and before any other member of this VM
+        // Derived VMs whose hooks use their own members have to call StopExecutor in their destructor
+        Executor& GetExecutor();
+        // Finishes the queued tasks and joins the workers, the next GetExecutor starts new ones. Must not be called by a task
+        void StopExecutor();
+        // Runs f on a new native thread, the destructor of this VM waits for it before destroying anything else
+        void StartThread(std::function<void()> f);
+
+        // Acquisitions and wait times of the VM, class and object locks of all VMs in this process, sorted by wait time
+        // Empty unless jnivm is built with JNIVM_ENABLE_LOCK_PROFILER, which replaces these locks with profiled ones
+        static std::vector<LockProfile> GetLockProfile();
+        // Human readable form of GetLockProfile
+        static std::string GetLockReport();
+        static void ResetLockProfile();
+
 #ifdef JNI_DEBUG
         // Dump all classes incl. function referenced or called from the (foreign) code
         // Namespace / Header Pre Declaration (no class body)
@@ -96,6 +198,12 @@ namespace jnivm {
         // Dumps all previous functions at once, into a single file
         void GenerateClassDump(const char * path);
 #endif
+    private:
+        std::mutex executormtx;
+        // Its workers may still use everything else while it is destroyed
+        std::unique_ptr<Executor> executor;
+        // Last member, its threads may submit tasks to executor
+        NativeThreads threads;
     };
 }
 #endif
\ No newline at end of file
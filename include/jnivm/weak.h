@@ -4,14 +4,42 @@ namespace jnivm {
 }
 #include <jnivm/object.h>
 #include <jnivm/extends.h>
+#include <jnivm/internal/globalReferenceTable.h>
 namespace jnivm {
     class Weak : public Extends<Object> {
     public:
+        Weak() {
+            kind = ObjectKind::Weak;
+        }
+        // Once registered in VM::globals only accessed via Get and Sweep, the VM may sweep it on any thread
         std::weak_ptr<Object> wrapped;
+        // Id in VM::globals
+        std::uint32_t slot = GlobalReferenceTable::None;
+
+        // Returns the target or nullptr if it was destroyed
+        // Guarded by Object::lock, MonitorEnter on a weak reference locks its target instead
+        std::shared_ptr<Object> Get() {
+            std::lock_guard<ObjectLock> guard(lock);
+            return wrapped.lock();
+        }
+        // Releases the control block of a destroyed target, returns false if the target is alive
+        bool Sweep() {
+            std::lock_guard<ObjectLock> guard(lock);
+            if(!wrapped.expired()) {
+                return false;
+            }
+            wrapped.reset();
+            return true;
+        }
     };
 
     class Global : public Extends<Object> {
     public:
+        Global() {
+            kind = ObjectKind::Global;
+        }
         std::shared_ptr<Object> wrapped;
+        // Id in VM::globals
+        std::uint32_t slot = GlobalReferenceTable::None;
     };
 }
\ No newline at end of file
@@ -254,39 +254,49 @@ namespace jnivm {
 
         template<class T> struct WrapperClasses<T, void> {
             using ReturnType = void;
+            using ValueType = std::conditional_t<Function::plength == 0, __JNIType<typename Function::Return>, __JNIType<typename Function::template Parameter<Function::plength < 1 ? 0 : Function::plength - 1>>>;
             struct StaticFunction : public MethodHandle {
             public:
-                StaticFunction(T&&t) : t(t) {}
+                StaticFunction(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ReturnType>(impl::HandleKind::StaticInvoke, &StaticInvoke);
+                }
                 T t;
-                virtual ReturnType StaticInvoke(ENV * env, Class* clazz, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    t.StaticInvoke(env, clazz, values);
+                static ReturnType StaticInvoke(void* t, ENV * env, Class* clazz, const jvalue* values) {
+                    static_cast<T*>(t)->StaticInvoke(env, clazz, values);
                 }
             };
             struct StaticSetter : public MethodHandle {
             public:
-                StaticSetter(T&&t) : t(t) {}
+                StaticSetter(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ValueType>(impl::HandleKind::StaticSet, &StaticSet);
+                }
                 T t;
-                virtual ReturnType StaticSet(ENV * env, Class* clazz, const jvalue* values, MethodHandleBase<std::conditional_t<Function::plength == 0, __JNIType<typename Function::Return>, __JNIType<typename Function::template Parameter<Function::plength < 1 ? 0 : Function::plength - 1>>>>) override {
-                    return t.StaticSet(env, clazz, values);
+                static ReturnType StaticSet(void* t, ENV * env, Class* clazz, const jvalue* values) {
+                    static_cast<T*>(t)->StaticSet(env, clazz, values);
                 }
             };
             struct InstanceFunction : public MethodHandle {
             public:
-                InstanceFunction(T&&t) : t(t) {}
+                InstanceFunction(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ReturnType>(impl::HandleKind::InstanceInvoke, &InstanceInvoke);
+                    SetThunk<ReturnType>(impl::HandleKind::NonVirtualInstanceInvoke, &NonVirtualInstanceInvoke);
+                }
                 T t;
-                virtual ReturnType InstanceInvoke(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    t.InstanceInvoke(env, obj, values);
+                static ReturnType InstanceInvoke(void* t, ENV * env, jobject obj, const jvalue* values) {
+                    static_cast<T*>(t)->InstanceInvoke(env, obj, values);
                 }
-                virtual ReturnType NonVirtualInstanceInvoke(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    t.NonVirtualInstanceInvoke(env, obj, values);
+                static ReturnType NonVirtualInstanceInvoke(void* t, ENV * env, jobject obj, const jvalue* values) {
+                    static_cast<T*>(t)->NonVirtualInstanceInvoke(env, obj, values);
                 }
             };
             struct InstanceSetter : public MethodHandle {
             public:
-                InstanceSetter(T&&t) : t(t) {}
+                InstanceSetter(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ValueType>(impl::HandleKind::InstanceSet, &InstanceSet);
+                }
                 T t;
-                virtual ReturnType InstanceSet(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<std::conditional_t<Function::plength == 0, __JNIType<typename Function::Return>, __JNIType<typename Function::template Parameter<Function::plength < 1 ? 0 : Function::plength - 1>>>>) override {
-                    t.InstanceSet(env, obj, values);
+                static ReturnType InstanceSet(void* t, ENV * env, jobject obj, const jvalue* values) {
+                    static_cast<T*>(t)->InstanceSet(env, obj, values);
                 }
             };
         };
@@ -294,37 +304,46 @@ namespace jnivm {
         template<class T, class ReturnType = __JNIType<typename Function::Return>> struct WrapperClasses {
             struct StaticFunction : public MethodHandle {
             public:
-                StaticFunction(T&&t) : t(t) {}
+                StaticFunction(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ReturnType>(impl::HandleKind::StaticInvoke, &StaticInvoke);
+                }
                 T t;
-                virtual ReturnType StaticInvoke(ENV * env, Class* clazz, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, t.StaticInvoke(env, clazz, values));
+                static ReturnType StaticInvoke(void* t, ENV * env, Class* clazz, const jvalue* values) {
+                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, static_cast<T*>(t)->StaticInvoke(env, clazz, values));
                 }
             };
             struct StaticGetter : public MethodHandle {
             public:
-                StaticGetter(T&&t) : t(t) {}
+                StaticGetter(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ReturnType>(impl::HandleKind::StaticGet, &StaticGet);
+                }
                 T t;
-                virtual ReturnType StaticGet(ENV * env, Class* clazz, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, t.StaticGet(env, clazz, values));
+                static ReturnType StaticGet(void* t, ENV * env, Class* clazz, const jvalue* values) {
+                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, static_cast<T*>(t)->StaticGet(env, clazz, values));
                 }
             };
             struct InstanceFunction : public MethodHandle {
             public:
-                InstanceFunction(T&&t) : t(t) {}
+                InstanceFunction(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ReturnType>(impl::HandleKind::InstanceInvoke, &InstanceInvoke);
+                    SetThunk<ReturnType>(impl::HandleKind::NonVirtualInstanceInvoke, &NonVirtualInstanceInvoke);
+                }
                 T t;
-                virtual ReturnType InstanceInvoke(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, t.InstanceInvoke(env, obj, values));
+                static ReturnType InstanceInvoke(void* t, ENV * env, jobject obj, const jvalue* values) {
+                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, static_cast<T*>(t)->InstanceInvoke(env, obj, values));
                 }
-                virtual ReturnType NonVirtualInstanceInvoke(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, t.NonVirtualInstanceInvoke(env, obj, values));
+                static ReturnType NonVirtualInstanceInvoke(void* t, ENV * env, jobject obj, const jvalue* values) {
+                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, static_cast<T*>(t)->NonVirtualInstanceInvoke(env, obj, values));
                 }
             };
             struct InstanceGetter : public MethodHandle {
             public:
-                InstanceGetter(T&&t) : t(t) {}
+                InstanceGetter(T&&t) : MethodHandle(&this->t), t(t) {
+                    SetThunk<ReturnType>(impl::HandleKind::InstanceGet, &InstanceGet);
+                }
                 T t;
-                virtual ReturnType InstanceGet(ENV * env, jobject obj, const jvalue* values, MethodHandleBase<ReturnType>) override {
-                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, t.InstanceGet(env, obj, values));
+                static ReturnType InstanceGet(void* t, ENV * env, jobject obj, const jvalue* values) {
+                    return JNITypes<typename Function::Return>::ToJNIReturnType(env, static_cast<T*>(t)->InstanceGet(env, obj, values));
                 }
             };
             // Workaround for Properties
@@ -17,10 +17,7 @@ std::shared_ptr<jnivm::ENV> Baron::Jvm::CreateEnv() {
     if(FakeJni::JniEnvContext::env.env.lock()) {
         throw std::runtime_error("Attempt to initialize a FakeJni::Env twice in one thread!");
     }
-    auto tmpl = GetNativeInterfaceTemplate();
-    for(auto && hook : jnienvhooks) {
-        hook(tmpl);
-    }
+    auto tmpl = GetHookedInterface();
     tmpl.FindClass = [](JNIEnv *env, const char *name) -> jclass {
         jclass ret = GetNativeInterfaceTemplate<true>().FindClass(env, name);
         if(ret)
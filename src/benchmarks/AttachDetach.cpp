@@ -0,0 +1,33 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <thread>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(AttachDetach) {
+    VM vm;
+    vm.AddHook([](JNINativeInterface& iface) {
+        iface.GetVersion = [](JNIEnv*) -> jint {
+            return JNI_VERSION_1_6;
+        };
+    });
+    auto jvm = vm.GetJavaVM();
+    auto attachdetach = [&](std::size_t) {
+        JNIEnv* env;
+        jvm->AttachCurrentThread(&env, nullptr);
+        DoNotOptimize(env);
+        jvm->DetachCurrentThread();
+    };
+    // The main thread stays attached
+    std::thread([&]() {
+        Measure("AttachCurrentThread + DetachCurrentThread", 100000, attachdetach);
+        vm.envpoolsize = 0;
+        Measure("AttachCurrentThread + DetachCurrentThread, no ENV pool", 100000, attachdetach);
+        vm.envpoolsize = VM::DefaultEnvPoolSize;
+    }).join();
+    auto none = [](std::size_t) {};
+    MeasureThreads("AttachCurrentThread + DetachCurrentThread", 4, 25000, none, [&](std::size_t, std::size_t i) {
+        attachdetach(i);
+    }, none);
+}
@@ -0,0 +1,47 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+namespace {
+    class BatchBase : public Extends<> {
+    public:
+        jint value = 0;
+    };
+    class BatchDerived : public Extends<BatchBase> {};
+}
+
+JNIVM_BENCHMARK(Batch) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass<BatchBase>("BatchBase");
+    env->GetClass<BatchDerived>("BatchDerived")->HookInstanceFunction(env, "Update", [](BatchDerived* self, jint a) {
+        self->value += a;
+    });
+    c->HookInstanceFunction(env, "Update", [](BatchBase* self, jint a) {
+        self->value -= a;
+    });
+    auto jenv = env->GetJNIEnv();
+    auto update = jenv->GetMethodID((jclass)c.get(), "Update", "(I)V");
+    constexpr std::size_t count = 100000;
+    std::vector<jobject> receivers(count);
+    for(std::size_t i = 0; i < count; ++i) {
+        receivers[i] = i % 2 ? JNITypes<std::shared_ptr<BatchDerived>>::ToJNIReturnType(env, std::make_shared<BatchDerived>()) : JNITypes<std::shared_ptr<BatchBase>>::ToJNIReturnType(env, std::make_shared<BatchBase>());
+    }
+    jvalue arg;
+    arg.i = 1;
+    Measure("CallVoidMethodA loop, 100000 receivers of 2 classes", 20, [&](std::size_t) {
+        for(auto&& obj : receivers) {
+            jenv->CallVoidMethodA(obj, update, &arg);
+        }
+    });
+    Measure("CallMethodBatch, 100000 receivers of 2 classes", 20, [&](std::size_t) {
+        env->CallMethodBatch(update, receivers.data(), count, &arg, 0, nullptr);
+    });
+    ((Method*)update)->threadsafe = true;
+    Measure("CallMethodBatch, 100000 receivers of 2 classes, 4 threads", 20, [&](std::size_t) {
+        env->CallMethodBatch(update, receivers.data(), count, &arg, 0, nullptr, 4);
+    });
+}
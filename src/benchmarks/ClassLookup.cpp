@@ -0,0 +1,37 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <string>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(ClassLookup) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto jenv = env->GetJNIEnv();
+    std::vector<std::string> names;
+    for(int i = 0; i < 1000; ++i) {
+        names.emplace_back("com/example/ClassLookup" + std::to_string(i));
+        jenv->DeleteLocalRef(jenv->FindClass(names.back().data()));
+    }
+    Measure("FindClass, 1000 classes", 1000000, [&](std::size_t i) {
+        jenv->DeleteLocalRef(jenv->FindClass(names[i % names.size()].data()));
+    });
+    Measure("ENV::GetClass, 1000 classes", 1000000, [&](std::size_t i) {
+        DoNotOptimize(env->GetClass(names[i % names.size()].data()));
+    });
+    auto jvm = vm.GetJavaVM();
+    std::vector<JNIEnv*> envs(16);
+    auto attach = [&](std::size_t t) {
+        jvm->AttachCurrentThread(&envs[t], nullptr);
+    };
+    auto detach = [&](std::size_t) {
+        jvm->DetachCurrentThread();
+    };
+    auto findclass = [&](std::size_t t, std::size_t i) {
+        envs[t]->DeleteLocalRef(envs[t]->FindClass(names[i % names.size()].data()));
+    };
+    MeasureThreads("FindClass, 1000 classes", 4, 250000, attach, findclass, detach);
+    MeasureThreads("FindClass, 1000 classes", 16, 62500, attach, findclass, detach);
+}
@@ -0,0 +1,33 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(EnvLookup) {
+    VM vm;
+    auto jvm = vm.GetJavaVM();
+    Measure("JavaVM::GetEnv", 1000000, [&](std::size_t) {
+        JNIEnv* env;
+        jvm->GetEnv((void**)&env, JNI_VERSION_1_6);
+        DoNotOptimize(env);
+    });
+    Measure("VM::GetEnv", 1000000, [&](std::size_t) {
+        DoNotOptimize(vm.GetEnv().get());
+    });
+    auto attach = [&](std::size_t) {
+        JNIEnv* env;
+        jvm->AttachCurrentThread(&env, nullptr);
+    };
+    auto detach = [&](std::size_t) {
+        jvm->DetachCurrentThread();
+    };
+    auto getenv = [&](std::size_t, std::size_t) {
+        JNIEnv* env;
+        jvm->GetEnv((void**)&env, JNI_VERSION_1_6);
+        DoNotOptimize(env);
+    };
+    MeasureThreads("JavaVM::GetEnv", 4, 250000, attach, getenv, detach);
+    MeasureThreads("JavaVM::GetEnv", 16, 62500, attach, getenv, detach);
+}
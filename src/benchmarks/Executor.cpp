@@ -0,0 +1,62 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <future>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(Executor) {
+    VM vm;
+    vm.executorthreads = 4;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass("ExecutorBenchmark");
+    c->Hook(env, "Add", [](jint a, jint b) {
+        return a + b;
+    });
+    auto jenv = env->GetJNIEnv();
+    auto add = jenv->GetStaticMethodID((jclass)c.get(), "Add", "(II)I");
+    auto cl = (jclass)c.get();
+    auto jvm = vm.GetJavaVM();
+    std::vector<std::future<jint>> futures(1000);
+    Measure("std::async + attach + call + detach, 1000 calls", 20, [&](std::size_t) {
+        for(auto&& future : futures) {
+            future = std::async(std::launch::async, [&]() {
+                JNIEnv* tenv;
+                jvm->AttachCurrentThread(&tenv, nullptr);
+                tenv->PushLocalFrame(16);
+                auto ret = tenv->CallStaticIntMethod(cl, add, 1, 2);
+                tenv->PopLocalFrame(nullptr);
+                jvm->DetachCurrentThread();
+                return ret;
+            });
+        }
+        for(auto&& future : futures) {
+            DoNotOptimize(future.get());
+        }
+    });
+    auto&& executor = vm.GetExecutor();
+    std::vector<std::future<InvokeResult>> results(1000);
+    jvalue args[2];
+    args[0].i = 1;
+    args[1].i = 2;
+    Measure("Executor::Invoke, 4 workers, 1000 calls", 20, [&](std::size_t) {
+        for(auto&& result : results) {
+            result = executor.Invoke(add, (jobject)cl, { args[0], args[1] });
+        }
+        for(auto&& result : results) {
+            DoNotOptimize(result.get().value.i);
+        }
+    });
+    Measure("Executor::Submit, 4 workers, 1000 calls", 20, [&](std::size_t) {
+        for(auto&& future : futures) {
+            future = executor.Submit([&](ENV* wenv) {
+                return wenv->GetJNIEnv()->CallStaticIntMethod(cl, add, 1, 2);
+            });
+        }
+        for(auto&& future : futures) {
+            DoNotOptimize(future.get());
+        }
+    });
+    vm.StopExecutor();
+}
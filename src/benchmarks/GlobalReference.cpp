@@ -0,0 +1,36 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(GlobalReference) {
+    VM vm;
+    auto jenv = vm.GetJNIEnv();
+    auto obj = std::make_shared<Object>();
+    auto ref = (jobject)obj.get();
+    std::vector<jobject> live(10000);
+    for(auto&& global : live) {
+        global = jenv->NewGlobalRef(ref);
+    }
+    Measure("NewGlobalRef + DeleteGlobalRef, 10000 live globals", 100000, [&](std::size_t) {
+        jenv->DeleteGlobalRef(jenv->NewGlobalRef(ref));
+    });
+    auto jvm = vm.GetJavaVM();
+    std::vector<JNIEnv*> envs(16);
+    auto attach = [&](std::size_t t) {
+        jvm->AttachCurrentThread(&envs[t], nullptr);
+    };
+    auto detach = [&](std::size_t) {
+        jvm->DetachCurrentThread();
+    };
+    auto createdelete = [&](std::size_t t, std::size_t) {
+        envs[t]->DeleteGlobalRef(envs[t]->NewGlobalRef(ref));
+    };
+    MeasureThreads("NewGlobalRef + DeleteGlobalRef, 10000 live globals", 4, 25000, attach, createdelete, detach);
+    MeasureThreads("NewGlobalRef + DeleteGlobalRef, 10000 live globals", 16, 6250, attach, createdelete, detach);
+    for(auto&& global : live) {
+        jenv->DeleteGlobalRef(global);
+    }
+}
@@ -0,0 +1,55 @@
+#include "benchmark.h"
+#include <jnivm.h>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(Invoke) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass("InvokeBenchmark");
+    c->Hook(env, "Test", [](jint a, jlong b, jdouble c, jint d) {
+        return a + (jint)b + (jint)c + d;
+    });
+    auto jenv = env->GetJNIEnv();
+    auto id = jenv->GetStaticMethodID((jclass)c.get(), "Test", "(IJDI)I");
+    Measure("CallStaticIntMethod varargs, 4 parameters", 1000000, [&](std::size_t i) {
+        DoNotOptimize(jenv->CallStaticIntMethod((jclass)c.get(), id, (jint)i, (jlong)2, 3.0, (jint)4));
+    });
+    jvalue values[4];
+    values[1].j = 2;
+    values[2].d = 3.0;
+    values[3].i = 4;
+    Measure("CallStaticIntMethodA, 4 parameters", 1000000, [&](std::size_t i) {
+        values[0].i = (jint)i;
+        DoNotOptimize(jenv->CallStaticIntMethodA((jclass)c.get(), id, values));
+    });
+    auto unresolved = jenv->GetStaticMethodID((jclass)c.get(), "Unresolved", "(IJDI)I");
+    Measure("CallStaticIntMethod varargs, unresolved stub", 1000000, [&](std::size_t i) {
+        DoNotOptimize(jenv->CallStaticIntMethod((jclass)c.get(), unresolved, (jint)i, (jlong)2, 3.0, (jint)4));
+    });
+    auto unresolvedobject = jenv->GetStaticMethodID((jclass)c.get(), "UnresolvedObject", "()LUnresolvedObject;");
+    Measure("CallStaticObjectMethod, unresolved stub", 1000000, [&](std::size_t i) {
+        jenv->PushLocalFrame(1);
+        DoNotOptimize(jenv->CallStaticObjectMethod((jclass)c.get(), unresolvedobject));
+        jenv->PopLocalFrame(nullptr);
+    });
+
+    JNINativeMethod natives[] = {
+        { "Native", "(IJ)J", (void*)+[](JNIEnv*, jclass, jint a, jlong b) -> jlong { return a + b; } },
+    };
+    jenv->RegisterNatives((jclass)c.get(), natives, 1);
+    Method* native;
+    {
+        std::lock_guard<jnivm::ClassMutex> lock(c->mtx);
+        native = c->FindMethod("Native", "(IJ)J", MemberKind::Native);
+    }
+    Measure("Method::invoke, registered native", 1000000, [&](std::size_t i) {
+        jenv->PushLocalFrame(1);
+        DoNotOptimize(native->invoke(*jenv, c.get(), (jint)i, (jlong)2));
+        jenv->PopLocalFrame(nullptr);
+    });
+    Measure("Method::invokeAs<jlong>, registered native", 1000000, [&](std::size_t i) {
+        DoNotOptimize(native->invokeAs<jlong>(*jenv, c.get(), (jint)i, (jlong)2));
+    });
+}
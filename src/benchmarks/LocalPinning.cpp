@@ -0,0 +1,44 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(LocalPinning) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass("LocalPinningBenchmark");
+    auto singleton = std::make_shared<Object>();
+    c->Hook(env, "getInstance", [singleton]() {
+        return singleton;
+    });
+    auto jenv = env->GetJNIEnv();
+    auto id = jenv->GetStaticMethodID((jclass)c.get(), "getInstance", "()Ljava/lang/Object;");
+    auto jvm = vm.GetJavaVM();
+    std::vector<JNIEnv*> envs(16);
+    auto attach = [&](std::size_t t) {
+        jvm->AttachCurrentThread(&envs[t], nullptr);
+    };
+    auto detach = [&](std::size_t) {
+        jvm->DetachCurrentThread();
+    };
+    auto getinstance = [&](std::size_t t, std::size_t) {
+        auto obj = envs[t]->CallStaticObjectMethodA((jclass)c.get(), id, nullptr);
+        envs[t]->DeleteLocalRef(obj);
+    };
+    auto getobjectclass = [&](std::size_t t, std::size_t) {
+        auto cl = envs[t]->GetObjectClass((jobject)c.get());
+        envs[t]->DeleteLocalRef(cl);
+    };
+    for(std::size_t threads : { 1, 4, 16 }) {
+        MeasureThreads("Shared singleton returned + DeleteLocalRef", threads, 400000 / threads, attach, getinstance, detach);
+    }
+    vm.Pin(singleton);
+    for(std::size_t threads : { 1, 4, 16 }) {
+        MeasureThreads("Pinned singleton returned + DeleteLocalRef", threads, 400000 / threads, attach, getinstance, detach);
+    }
+    for(std::size_t threads : { 1, 4, 16 }) {
+        MeasureThreads("GetObjectClass + DeleteLocalRef", threads, 400000 / threads, attach, getobjectclass, detach);
+    }
+}
@@ -0,0 +1,40 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(LocalReference) {
+    VM vm;
+    auto jenv = vm.GetJNIEnv();
+    auto obj = std::make_shared<Object>();
+    auto ref = (jobject)obj.get();
+    Measure("NewLocalRef + DeleteLocalRef", 1000000, [&](std::size_t) {
+        jenv->DeleteLocalRef(jenv->NewLocalRef(ref));
+    });
+    std::vector<std::shared_ptr<Object>> objects(10000);
+    for(auto&& o : objects) {
+        o = std::make_shared<Object>();
+    }
+    jenv->PushLocalFrame(0);
+    for(auto&& o : objects) {
+        jenv->NewLocalRef((jobject)o.get());
+    }
+    Measure("NewLocalRef + DeleteLocalRef, 10000 older references in the frame", 1000000, [&](std::size_t) {
+        jenv->DeleteLocalRef(jenv->NewLocalRef(ref));
+    });
+    Measure("DeleteLocalRef of the oldest reference and recreate it, 10000 references", 100000, [&](std::size_t i) {
+        auto o = (jobject)objects[i % objects.size()].get();
+        jenv->DeleteLocalRef(o);
+        jenv->NewLocalRef(o);
+    });
+    jenv->PopLocalFrame(nullptr);
+    Measure("PushLocalFrame + 16 NewLocalRef + PopLocalFrame", 100000, [&](std::size_t) {
+        jenv->PushLocalFrame(16);
+        for(int i = 0; i < 16; i++) {
+            jenv->NewLocalRef((jobject)objects[i].get());
+        }
+        jenv->PopLocalFrame(nullptr);
+    });
+}
@@ -0,0 +1,48 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+namespace {
+    class Item : public Extends<> {};
+}
+
+// Build with JNIVM_ENABLE_LOCK_PROFILER to get the report, compare the timings of both builds for its overhead
+JNIVM_BENCHMARK(LockProfile) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass<Item>("Item");
+    c->HookInstanceFunction(env, "Test", [](Item*, Item*) {
+        return 1;
+    });
+    auto jenv = env->GetJNIEnv();
+    auto obj = JNITypes<std::shared_ptr<Item>>::ToJNIReturnType(env, std::make_shared<Item>());
+    auto id = jenv->GetMethodID((jclass)c.get(), "Test", "(LItem;)I");
+    auto jvm = vm.GetJavaVM();
+    std::vector<JNIEnv*> envs(16);
+    auto attach = [&](std::size_t t) {
+        jvm->AttachCurrentThread(&envs[t], nullptr);
+    };
+    auto detach = [&](std::size_t) {
+        jvm->DetachCurrentThread();
+    };
+    // Every profiled lock except VM::hookmtx, which is only taken when a thread attaches
+    auto mixed = [&](std::size_t t, std::size_t i) {
+        auto jenv = envs[t];
+        auto cl = jenv->FindClass("Item");
+        DoNotOptimize(jenv->GetMethodID(cl, "Test", "(LItem;)I"));
+        jenv->DeleteLocalRef(cl);
+        jenv->MonitorEnter(obj);
+        DoNotOptimize(jenv->CallIntMethod(obj, id, obj));
+        jenv->MonitorExit(obj);
+    };
+    for(std::size_t threads = 1; threads <= 16; threads *= 4) {
+        VM::ResetLockProfile();
+        MeasureThreads("FindClass + GetMethodID + synchronized hooked call", threads, 160000 / threads, attach, mixed, detach);
+        printf("%s", VM::GetLockReport().data());
+    }
+}
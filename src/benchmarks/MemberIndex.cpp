@@ -0,0 +1,43 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <algorithm>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(MemberIndex) {
+    for(std::size_t members : { 10, 100, 1000, 10000 }) {
+        VM vm;
+        auto env = vm.GetEnv();
+        auto cl = env->GetClass("BenchmarkClass");
+        std::vector<std::string> names;
+        for(std::size_t i = 0; i < members; ++i) {
+            names.push_back("member" + std::to_string(i));
+        }
+        auto start = std::chrono::steady_clock::now();
+        for(auto&& name : names) {
+            cl->HookInstanceFunction(env.get(), name, [](Object* obj, jint i) {});
+        }
+        auto end = std::chrono::steady_clock::now();
+        printf("%-60s %12.1f ns/op (%zu iterations)\n", ("Hook, members=" + std::to_string(members)).data(), std::chrono::duration<double, std::nano>(end - start).count() / members, members);
+
+        auto jenv = env->GetJNIEnv();
+        auto c = jenv->FindClass("BenchmarkClass");
+        Measure("GetMethodID, members=" + std::to_string(members), 100000, [&](std::size_t i) {
+            DoNotOptimize(jenv->GetMethodID(c, names[(i * 7919) % members].data(), "(I)V"));
+        });
+        Measure("Class::FindMethod, members=" + std::to_string(members), 100000, [&](std::size_t i) {
+            std::lock_guard<jnivm::ClassMutex> lock(cl->mtx);
+            DoNotOptimize(cl->FindMethod(names[(i * 7919) % members].data(), "(I)V", MemberKind::Instance));
+        });
+        // Baseline, the linear scan used before the index was added
+        std::string sig = "(I)V";
+        Measure("linear scan, members=" + std::to_string(members), members > 1000 ? 10000 : 100000, [&](std::size_t i) {
+            std::lock_guard<jnivm::ClassMutex> lock(cl->mtx);
+            auto&& sname = names[(i * 7919) % members];
+            DoNotOptimize(std::find_if(cl->methods.begin(), cl->methods.end(), [&sname, &sig](std::shared_ptr<Method> &m) {
+                return !m->_static && !m->native && m->name == sname && m->signature == sig;
+            }));
+        });
+    }
+}
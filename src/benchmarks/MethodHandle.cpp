@@ -0,0 +1,52 @@
+#include "benchmark.h"
+#include <jnivm.h>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+namespace {
+    class HandleObject : public Object {
+    public:
+        jint value = 0;
+        static jint staticvalue;
+        jint Test(jint a) {
+            return value + a;
+        }
+    };
+    jint HandleObject::staticvalue = 0;
+}
+
+JNIVM_BENCHMARK(MethodHandle) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass<HandleObject>("HandleObject");
+    c->Hook(env, "Test", &HandleObject::Test);
+    c->Hook(env, "StaticTest", [](jint a) {
+        return a;
+    });
+    c->Hook(env, "value", &HandleObject::value);
+    c->Hook(env, "staticvalue", &HandleObject::staticvalue);
+    auto jenv = env->GetJNIEnv();
+    auto obj = JNITypes<std::shared_ptr<HandleObject>>::ToJNIReturnType(env, std::make_shared<HandleObject>());
+    jvalue values[1];
+    auto test = jenv->GetMethodID((jclass)c.get(), "Test", "(I)I");
+    Measure("CallIntMethodA, hooked member function", 1000000, [&](std::size_t i) {
+        values[0].i = (jint)i;
+        DoNotOptimize(jenv->CallIntMethodA(obj, test, values));
+    });
+    auto statictest = jenv->GetStaticMethodID((jclass)c.get(), "StaticTest", "(I)I");
+    Measure("CallStaticIntMethodA, hooked lambda", 1000000, [&](std::size_t i) {
+        values[0].i = (jint)i;
+        DoNotOptimize(jenv->CallStaticIntMethodA((jclass)c.get(), statictest, values));
+    });
+    auto field = jenv->GetFieldID((jclass)c.get(), "value", "I");
+    Measure("SetIntField + GetIntField, hooked member", 1000000, [&](std::size_t i) {
+        jenv->SetIntField(obj, field, (jint)i);
+        DoNotOptimize(jenv->GetIntField(obj, field));
+    });
+    auto staticfield = jenv->GetStaticFieldID((jclass)c.get(), "staticvalue", "I");
+    Measure("SetStaticIntField + GetStaticIntField, hooked static member", 1000000, [&](std::size_t i) {
+        jenv->SetStaticIntField((jclass)c.get(), staticfield, (jint)i);
+        DoNotOptimize(jenv->GetStaticIntField((jclass)c.get(), staticfield));
+    });
+}
@@ -0,0 +1,35 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <mutex>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(ObjectLock) {
+    printf("sizeof(jnivm::Object) %zu bytes\n", sizeof(Object));
+    VM vm;
+    auto jenv = vm.GetJNIEnv();
+    auto obj = std::make_shared<Object>();
+    auto ref = (jobject)obj.get();
+    Measure("MonitorEnter + MonitorExit", 1000000, [&](std::size_t) {
+        jenv->MonitorEnter(ref);
+        jenv->MonitorExit(ref);
+    });
+    auto global = jenv->NewGlobalRef(ref);
+    Measure("MonitorEnter + MonitorExit, global reference", 1000000, [&](std::size_t) {
+        jenv->MonitorEnter(global);
+        jenv->MonitorExit(global);
+    });
+    jenv->DeleteGlobalRef(global);
+    jenv->MonitorEnter(ref);
+    Measure("MonitorEnter + MonitorExit, nested", 1000000, [&](std::size_t) {
+        jenv->MonitorEnter(ref);
+        jenv->MonitorExit(ref);
+    });
+    jenv->MonitorExit(ref);
+    auto contended = std::make_shared<Object>();
+    auto none = [](std::size_t) {};
+    MeasureThreads("lock + unlock, shared object", 4, 250000, none, [&](std::size_t, std::size_t) {
+        std::lock_guard<jnivm::ObjectLock> lock(contended->lock);
+    }, none);
+}
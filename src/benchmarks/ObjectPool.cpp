@@ -0,0 +1,32 @@
+#include "benchmark.h"
+#include <jnivm.h>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+JNIVM_BENCHMARK(ObjectPool) {
+    VM vm;
+    auto env = vm.GetEnv();
+    auto jenv = env->GetJNIEnv();
+    auto strings = [&](std::size_t) {
+        jenv->PushLocalFrame(64);
+        for(int i = 0; i < 64; i++) {
+            DoNotOptimize(jenv->NewStringUTF("short lived"));
+        }
+        jenv->PopLocalFrame(nullptr);
+    };
+    auto arrays = [&](std::size_t) {
+        jenv->PushLocalFrame(64);
+        for(int i = 0; i < 64; i++) {
+            DoNotOptimize(jenv->NewIntArray(4));
+        }
+        jenv->PopLocalFrame(nullptr);
+    };
+    Measure("64 NewStringUTF in a local frame", 20000, strings);
+    Measure("64 NewIntArray in a local frame", 20000, arrays);
+#ifdef EnableJNIVMPool
+    env->pool.reset();
+    Measure("64 NewStringUTF in a local frame, pool disabled", 20000, strings);
+    Measure("64 NewIntArray in a local frame, pool disabled", 20000, arrays);
+#endif
+}
@@ -0,0 +1,34 @@
+#include "benchmark.h"
+#include <jnivm.h>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+namespace {
+    class UnpackBase : public Extends<> {
+    };
+    class UnpackDerived : public Extends<UnpackBase> {
+    };
+}
+
+JNIVM_BENCHMARK(Unpack) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto jenv = env->GetJNIEnv();
+    auto obj = std::make_shared<UnpackDerived>();
+    auto ref = (jobject)static_cast<Object*>(obj.get());
+    Measure("JNICast to the exact type", 1000000, [&](std::size_t) {
+        DoNotOptimize(JNITypes<std::shared_ptr<UnpackDerived>>::JNICast(env, ref).get());
+    });
+    Measure("JNICast to a base type", 1000000, [&](std::size_t) {
+        DoNotOptimize(JNITypes<std::shared_ptr<UnpackBase>>::JNICast(env, ref).get());
+    });
+    auto global = jenv->NewGlobalRef(ref);
+    Measure("JNICast of a global reference", 1000000, [&](std::size_t) {
+        DoNotOptimize(JNITypes<std::shared_ptr<UnpackDerived>>::JNICast(env, global).get());
+    });
+    Measure("GetObjectRefType", 1000000, [&](std::size_t) {
+        DoNotOptimize(jenv->GetObjectRefType(ref));
+    });
+    jenv->DeleteGlobalRef(global);
+}
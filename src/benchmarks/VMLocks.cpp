@@ -0,0 +1,45 @@
+#include "benchmark.h"
+#include <jnivm.h>
+#include <string>
+#include <vector>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+namespace {
+    class Item : public Extends<> {};
+}
+
+JNIVM_BENCHMARK(VMLocks) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass<Item>("Item");
+    c->HookInstanceFunction(env, "Test", [](Item*, Item*) {
+        return 1;
+    });
+    std::vector<std::string> names;
+    for(int i = 0; i < 16; ++i) {
+        names.emplace_back("VMLocks" + std::to_string(i));
+    }
+    auto jenv = env->GetJNIEnv();
+    auto obj = JNITypes<std::shared_ptr<Item>>::ToJNIReturnType(env, std::make_shared<Item>());
+    auto id = jenv->GetMethodID((jclass)c.get(), "Test", "(LItem;)I");
+    auto jvm = vm.GetJavaVM();
+    std::vector<JNIEnv*> envs(16);
+    auto attach = [&](std::size_t t) {
+        jvm->AttachCurrentThread(&envs[t], nullptr);
+    };
+    auto detach = [&](std::size_t) {
+        jvm->DetachCurrentThread();
+    };
+    // FindClass, NewGlobalRef and a hooked call, which used to serialize on one VM mutex
+    auto mixed = [&](std::size_t t, std::size_t i) {
+        auto jenv = envs[t];
+        jenv->DeleteLocalRef(jenv->FindClass(names[i % names.size()].data()));
+        jenv->DeleteGlobalRef(jenv->NewGlobalRef(obj));
+        DoNotOptimize(jenv->CallIntMethod(obj, id, obj));
+    };
+    for(std::size_t threads = 1; threads <= 16; threads *= 2) {
+        MeasureThreads("FindClass + NewGlobalRef + hooked call", threads, 160000 / threads, attach, mixed, detach);
+    }
+}
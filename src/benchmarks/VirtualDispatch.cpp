@@ -0,0 +1,36 @@
+#include "benchmark.h"
+#include <jnivm.h>
+
+using namespace jnivm;
+using namespace jnivm::benchmark;
+
+namespace {
+    class Base : public Extends<> {};
+    class Derived : public Extends<Base> {};
+    class Derived2 : public Extends<Derived> {};
+    class Derived3 : public Extends<Derived2> {};
+}
+
+JNIVM_BENCHMARK(VirtualDispatch) {
+    VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass<Base>("Base");
+    env->GetClass<Derived>("Derived")->HookInstanceFunction(env, "Test", [](Derived*) {
+        return 1;
+    });
+    env->GetClass<Derived2>("Derived2");
+    env->GetClass<Derived3>("Derived3");
+    c->HookInstanceFunction(env, "Test", [](Base*) {
+        return 0;
+    });
+    auto jenv = env->GetJNIEnv();
+    auto obj = JNITypes<std::shared_ptr<Derived3>>::ToJNIReturnType(env, std::make_shared<Derived3>());
+    auto id = jenv->GetMethodID((jclass)c.get(), "Test", "()I");
+    Measure("CallIntMethod, override 2 levels above the object class", 1000000, [&](std::size_t) {
+        DoNotOptimize(jenv->CallIntMethod(obj, id));
+    });
+    Measure("CallIntMethod, invalidated before every call", 100000, [&](std::size_t) {
+        Class::InvalidateVTables(env);
+        DoNotOptimize(jenv->CallIntMethod(obj, id));
+    });
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jnivm {
+    namespace benchmark {
+        struct Entry {
+            const char* name;
+            std::function<void()> run;
+        };
+
+        inline std::vector<Entry>& Registry() {
+            static std::vector<Entry> entries;
+            return entries;
+        }
+
+        struct Register {
+            Register(const char* name, std::function<void()> run) {
+                Registry().push_back({ name, std::move(run) });
+            }
+        };
+
+        // Prevents the compiler from optimizing away the result of a benchmarked expression
+        template<class T> inline void DoNotOptimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+            asm volatile("" : : "r,m"(value) : "memory");
+#else
+            static volatile const void* sink;
+            sink = &value;
+#endif
+        }
+
+        // Runs f iterations times and prints the average duration of one iteration
+        template<class F> void Measure(const std::string& label, std::size_t iterations, F&& f) {
+            auto start = std::chrono::steady_clock::now();
+            for(std::size_t i = 0; i < iterations; ++i) {
+                f(i);
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+            printf("%-60s %12.1f ns/op (%zu iterations)\n", label.data(), ns, iterations);
+        }
+
+        // Runs f(thread, i) iterations times on each of threads threads and prints the wall time divided by all iterations
+        // setup(thread) and teardown(thread) run on the benchmarked thread outside of the measured time, like attaching a JNIEnv
+        template<class Setup, class F, class Teardown> void MeasureThreads(const std::string& label, std::size_t threads, std::size_t iterations, Setup&& setup, F&& f, Teardown&& teardown) {
+            std::atomic<std::size_t> ready { 0 };
+            std::atomic<bool> go { false };
+            std::vector<std::chrono::steady_clock::time_point> ends(threads);
+            std::vector<std::thread> workers;
+            for(std::size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t]() {
+                    setup(t);
+                    ready.fetch_add(1);
+                    while(!go.load()) {
+                        std::this_thread::yield();
+                    }
+                    for(std::size_t i = 0; i < iterations; ++i) {
+                        f(t, i);
+                    }
+                    ends[t] = std::chrono::steady_clock::now();
+                    teardown(t);
+                });
+            }
+            while(ready.load() != threads) {
+                std::this_thread::yield();
+            }
+            auto start = std::chrono::steady_clock::now();
+            go.store(true);
+            for(auto&& worker : workers) {
+                worker.join();
+            }
+            auto end = *std::max_element(ends.begin(), ends.end());
+            double ns = std::chrono::duration<double, std::nano>(end - start).count() / (threads * iterations);
+            printf("%-60s %12.1f ns/op (%zu threads x %zu iterations)\n", label.data(), ns, threads, iterations);
+        }
+    }
+}
+
+#define JNIVM_BENCHMARK_CONCAT2(a, b) a##b
+#define JNIVM_BENCHMARK_CONCAT(a, b) JNIVM_BENCHMARK_CONCAT2(a, b)
+#define JNIVM_BENCHMARK(name) \
+    static void JNIVM_BENCHMARK_CONCAT(Benchmark_, name)(); \
+    static ::jnivm::benchmark::Register JNIVM_BENCHMARK_CONCAT(BenchmarkRegister_, name)(#name, &JNIVM_BENCHMARK_CONCAT(Benchmark_, name)); \
+    static void JNIVM_BENCHMARK_CONCAT(Benchmark_, name)()
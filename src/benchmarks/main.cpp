@@ -0,0 +1,16 @@
+#include "benchmark.h"
+#include <cstring>
+
+// Usage: JNIVMBenchmarks [filter]
+// Runs every benchmark whose name contains filter, or all of them
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    for(auto&& entry : jnivm::benchmark::Registry()) {
+        if(filter && !strstr(entry.name, filter)) {
+            continue;
+        }
+        printf("[ %s ]\n", entry.name);
+        entry.run();
+    }
+    return 0;
+}
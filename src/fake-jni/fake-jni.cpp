@@ -110,11 +110,12 @@ void FakeJni::Jvm::start() {
 }
 
 void FakeJni::Jvm::start(std::shared_ptr<FakeJni::JArray<FakeJni::JString>> args) {
-	for(auto&& c : classes) {
+	// A snapshot, main may declare new classes
+	for(auto&& c : getClasses()) {
 		LocalFrame frame(*this);
-		auto main = c.second->getMethod("([Ljava/lang/String;)V", "main");
+		auto main = c->getMethod("([Ljava/lang/String;)V", "main");
 		if(main != nullptr) {
-			main->invoke(frame.getJniEnv(), c.second.get(), args);
+			main->invoke(frame.getJniEnv(), c.get(), args);
 			return;
 		}
 	}
@@ -27,10 +27,7 @@ std::shared_ptr<jnivm::ENV> FakeJni::Jvm::CreateEnv() {
     if(FakeJni::JniEnvContext::env.env.lock()) {
         throw std::runtime_error("Attempt to initialize a FakeJni::Env twice in one thread!");
     }
-    auto tmpl = GetNativeInterfaceTemplate();
-	for(auto && hook : jnienvhooks) {
-        hook(tmpl);
-    }
+    auto tmpl = GetHookedInterface();
     auto ret = std::make_shared<Env>(*this, static_cast<jnivm::VM*>(this), tmpl);
     FakeJni::JniEnvContext::env.env = ret;
     return std::shared_ptr<jnivm::ENV>(ret, jnivm::ENV::FromJNIEnv(ret.get()));
@@ -38,6 +35,7 @@ std::shared_ptr<jnivm::ENV> FakeJni::Jvm::CreateEnv() {
 
 std::vector<std::shared_ptr<jnivm::Class>> FakeJni::Jvm::getClasses() {
     std::vector<std::shared_ptr<jnivm::Class>> ret;
+    std::shared_lock<jnivm::ClassesMutex> lock(classesmtx);
     for(auto&& c : classes) {
         ret.emplace_back(c.second);
     }
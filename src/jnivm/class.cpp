@@ -0,0 +1,104 @@
+#include <jnivm.h>
+#include <jnivm/class.h>
+#include <jnivm/method.h>
+#include "internal/log.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace jnivm;
+
+Method* Class::FindMethod(const char* name, const char* signature, MemberKind kind) const {
+    return methodindex.Find(name, signature, kind);
+}
+
+Method* Class::FindMethod(const std::string& name, const std::string& signature, MemberKind kind) const {
+    return methodindex.Find(name, signature, kind);
+}
+
+void Class::AddMethod(std::shared_ptr<Method> method) {
+    methodindex.Insert(method.get());
+    methods.emplace_back(std::move(method));
+}
+
+void Class::RemoveMethod(Method* method) {
+    auto m = std::find_if(methods.begin(), methods.end(), [method](const std::shared_ptr<Method>& m) {
+        return m.get() == method;
+    });
+    if(m != methods.end()) {
+        methodindex.Erase(method);
+        methods.erase(m);
+    }
+}
+
+Field* Class::FindField(const char* name, const char* signature, MemberKind kind) const {
+    return fieldindex.Find(name, signature, kind);
+}
+
+Field* Class::FindField(const std::string& name, const std::string& signature, MemberKind kind) const {
+    return fieldindex.Find(name, signature, kind);
+}
+
+void Class::AddField(std::shared_ptr<Field> field) {
+    fieldindex.Insert(field.get());
+    fields.emplace_back(std::move(field));
+}
+
+void Class::InvalidateVTables(ENV* env) {
+    env->GetVM()->vtablerevision.fetch_add(1, std::memory_order_acq_rel);
+}
+
+static Method* FindOverride(ENV* env, Class* cl, Method* method) {
+    {
+        std::lock_guard<ClassMutex> lock(cl->mtx);
+        auto m = cl->FindMethod(method->name, method->signature, MemberKind::Instance);
+        if(m && m->nativehandle) {
+            return m;
+        }
+    }
+    if(cl->baseclasses) {
+        std::vector<std::shared_ptr<Class>> bases;
+        try {
+            bases = cl->baseclasses(env);
+        } catch(const std::exception& ex) {
+            // An unregistered base class, stop searching this part of the hierarchy
+#ifdef JNI_TRACE
+            LOG("JNIVM", "Failed to get base classes of Class=`%s`: %s", cl->nativeprefix.data(), ex.what());
+#endif
+            return nullptr;
+        }
+        for(auto&& base : bases) {
+            if(base && base.get() != cl) {
+                if(auto m = FindOverride(env, base.get(), method)) {
+                    return m;
+                }
+            }
+        }
+    }
+    return nullptr;
+}
+
+Method* Class::GetVirtualOverride(ENV* env, Method* method) {
+    auto epoch = env->GetVM()->vtablerevision.load(std::memory_order_acquire);
+    {
+        std::lock_guard<ClassMutex> lock(mtx);
+        if(vtableepoch != epoch) {
+            vtable.clear();
+            vtableepoch = epoch;
+        } else {
+            auto entry = vtable.find(method);
+            if(entry != vtable.end()) {
+                return entry->second;
+            }
+        }
+    }
+    // Walk the hierarchy without holding mtx, base classes take their own lock
+    auto resolved = FindOverride(env, this, method);
+    if(!resolved) {
+        resolved = method;
+    }
+    std::lock_guard<ClassMutex> lock(mtx);
+    if(vtableepoch == epoch) {
+        vtable[method] = resolved;
+    }
+    return resolved;
+}
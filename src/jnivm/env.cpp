@@ -2,16 +2,51 @@
 #include <jnivm/object.h>
 #include <jnivm/internal/findclass.h>
 #include <jnivm/class.h>
+#include <atomic>
 #include <stdexcept>
 
 using namespace jnivm;
 
 jnivm::ENV::ENV(jnivm::VM *vm, const JNINativeInterface &defaultinterface) : vm(vm), ninterface(defaultinterface), env{&ninterface}
-#ifdef EnableJNIVMGC
-, localframe({{}})
-#endif
 {
     ninterface.reserved0 = this;
+#ifdef EnableJNIVMPool
+    pool = std::make_shared<ObjectPool>();
+#endif
+    MonitorLocalReferences();
+}
+
+void jnivm::ENV::MonitorLocalReferences() {
+#ifdef EnableJNIVMGC
+    localrefs.onpeak = [this, next = std::size_t(0)](std::size_t count) mutable {
+        auto threshold = this->vm->localthreshold.load(std::memory_order_relaxed);
+        if(threshold && count >= threshold && count >= next) {
+            next = count * 2;
+            this->vm->ReportReferences(this, ReferenceKind::Local, count);
+        }
+    };
+#endif
+}
+
+void jnivm::ENV::Reset() {
+#ifdef EnableJNIVMGC
+    localrefs.Reset();
+    // The next thread starts with its own report threshold
+    MonitorLocalReferences();
+#endif
+    current_exception = nullptr;
+    TrimPool();
+}
+
+void jnivm::ENV::TrimPool() {
+#ifdef EnableJNIVMPool
+    // Every pooled allocation holds a reference to the pool until it is deallocated
+    if(pool && pool.use_count() == 1) {
+        // Pairs with the release of the last reference, blocks freed by other threads are complete
+        std::atomic_thread_fence(std::memory_order_acquire);
+        pool->Trim();
+    }
+#endif
 }
 
 std::shared_ptr<Class> ENV::GetClass(const char * name) {
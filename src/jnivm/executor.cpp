@@ -0,0 +1,154 @@
+#include <jnivm/executor.h>
+#include <jnivm/env.h>
+#include <jnivm/method.h>
+#include <jnivm/jnitypes.h>
+#include <algorithm>
+
+using namespace jnivm;
+
+namespace {
+    // Executor, queue and ENV of the current worker thread
+    thread_local const Executor* currentexecutor = nullptr;
+    thread_local std::size_t currentworker = 0;
+    thread_local ENV* currentenv = nullptr;
+}
+
+Executor::Executor(VM* vm, std::size_t threads) : vm(vm) {
+    threads = std::max<std::size_t>(threads, 1);
+    for(std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    for(std::size_t i = 0; i < threads; ++i) {
+        workers[i]->thread = std::thread(&Executor::Run, this, i);
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    wakeup.notify_all();
+    for(auto&& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void Executor::Push(std::unique_ptr<Task> task) {
+    // Tasks of a worker usually belong to its current task, keep them on its queue
+    auto index = currentexecutor == this ? currentworker : next.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    {
+        auto&& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mtx);
+        worker.tasks.emplace_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ++pending;
+    }
+    wakeup.notify_one();
+}
+
+std::unique_ptr<Executor::Task> Executor::Pop(std::size_t self) {
+    {
+        auto&& worker = *workers[self];
+        std::lock_guard<std::mutex> lock(worker.mtx);
+        if(!worker.tasks.empty()) {
+            auto task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            return task;
+        }
+    }
+    for(std::size_t i = 1; i < workers.size(); ++i) {
+        auto&& victim = *workers[(self + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if(!victim.tasks.empty()) {
+            auto task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+bool Executor::IsWorker() const {
+    return currentexecutor == this;
+}
+
+bool Executor::Help() {
+    if(!IsWorker()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(!pending) {
+            return false;
+        }
+        --pending;
+    }
+    std::unique_ptr<Task> task;
+    while(!(task = Pop(currentworker))) {
+        std::this_thread::yield();
+    }
+    // The waiting task runs on the same ENV, keep its pending exception
+    auto exception = std::move(currentenv->current_exception);
+    RunTask(currentenv, *task);
+    currentenv->current_exception = std::move(exception);
+    return true;
+}
+
+void Executor::RunTask(ENV* env, Task& task) {
+    auto jenv = env->GetJNIEnv();
+    jenv->PushLocalFrame(16);
+    task.Run(env);
+    env->current_exception = nullptr;
+    jenv->PopLocalFrame(nullptr);
+}
+
+void Executor::Run(std::size_t self) {
+    currentexecutor = this;
+    currentworker = self;
+    auto jvm = vm->GetJavaVM();
+    JNIEnv* jenv = nullptr;
+    jvm->AttachCurrentThread(&jenv, nullptr);
+    auto env = ENV::FromJNIEnv(jenv);
+    currentenv = env;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wakeup.wait(lock, [this]() { return pending || stop; });
+            if(!pending) {
+                break;
+            }
+            // Claims one queued task, claims never exceed the queued tasks
+            --pending;
+        }
+        std::unique_ptr<Task> task;
+        // Another worker may have taken the task this one was woken for, but then another task is queued
+        while(!(task = Pop(self))) {
+            std::this_thread::yield();
+        }
+        RunTask(env, *task);
+    }
+    jvm->DetachCurrentThread();
+}
+
+std::future<InvokeResult> Executor::Invoke(jmethodID id, jobject receiver, std::vector<jvalue> args) {
+    return Submit([id, receiver, args = std::move(args)](ENV* env) mutable {
+        auto mid = (Method*)id;
+        InvokeResult result {};
+        auto value = mid->_static ? mid->jinvoke(*env, (jclass)receiver, args.data()) : mid->jinvoke(*env, receiver, args.data());
+        if(env->current_exception) {
+            result.exception = std::move(env->current_exception);
+            return result;
+        }
+        result.value = value;
+        auto kind = mid->GetReturnKind();
+        if((kind == 'L' || kind == '[') && value.l) {
+            // The local reference of the worker is released with its frame
+            result.object = JNITypes<std::shared_ptr<Object>>::JNICast(env, value.l);
+            result.value.l = (jobject)result.object.get();
+        }
+        return result;
+    });
+}
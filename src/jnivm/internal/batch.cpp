@@ -0,0 +1,226 @@
+#include "method.h"
+#include "log.h"
+#include <jnivm/env.h>
+#include <jnivm/vm.h>
+#include <jnivm/throwable.h>
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <utility>
+#include <vector>
+
+using namespace jnivm;
+
+namespace {
+    // Threads are only worth starting for chunks of at least this many calls
+    constexpr std::size_t MinParallelChunk = 1024;
+
+    // Override cache of one batch, receivers of a batch usually share very few classes
+    class BatchResolver {
+        struct Target {
+            Class* cl;
+            Method* method;
+            // Keeps classes not owned by the VM alive, so their address isn't reused during the batch
+            std::shared_ptr<Class> owner;
+        };
+        std::vector<Target> targets;
+    public:
+        Method* Resolve(ENV* env, Class* cl, std::shared_ptr<Class>& owner, Method* mid) {
+            for(auto&& target : targets) {
+                if(target.cl == cl) {
+                    return target.method;
+                }
+            }
+            JNIVM_LOCK_CALLSITE("CallMethodBatch");
+            auto target = cl->GetVirtualOverride(env, mid);
+            targets.push_back({ cl, target, std::move(owner) });
+            return target;
+        }
+    };
+
+    template<class T> struct BatchCall {
+        static void Invoke(ENV* env, Method* target, jobject obj, const jvalue* values, jvalue* result) {
+            auto ret = target->nativehandle->InstanceInvoke<T>(env, obj, values);
+            if(result) {
+                *result = toJValue(ret);
+            }
+        }
+        static void Fallback(ENV* env, jobject obj, jmethodID id, const jvalue* values, jvalue* result) {
+            auto ret = MDispatchBase2<T>::CallMethod(env->GetJNIEnv(), obj, id, const_cast<jvalue*>(values));
+            if(result) {
+                *result = toJValue(ret);
+            }
+        }
+    };
+
+    template<> struct BatchCall<void> {
+        static void Invoke(ENV* env, Method* target, jobject obj, const jvalue* values, jvalue*) {
+            target->nativehandle->InstanceInvoke<void>(env, obj, values);
+        }
+        static void Fallback(ENV* env, jobject obj, jmethodID id, const jvalue* values, jvalue*) {
+            MDispatchBase2<void>::CallMethod(env->GetJNIEnv(), obj, id, const_cast<jvalue*>(values));
+        }
+    };
+
+    // Calls receivers [begin, end) and returns the index of the first call raising an exception or end
+    template<class T> std::size_t CallBatch(ENV* env, Method* mid, const jobject* receivers, std::size_t begin, std::size_t end, const jvalue* args, std::size_t stride, jvalue* results) {
+        if(!mid->nativehandle) {
+            // Stubs and methods registered via RegisterNatives take the regular path
+            for(std::size_t i = begin; i < end; ++i) {
+                BatchCall<T>::Fallback(env, receivers[i], (jmethodID)mid, args + i * stride, results ? results + i : nullptr);
+                if(env->current_exception) {
+                    return i;
+                }
+            }
+            return end;
+        }
+        BatchResolver resolver;
+        for(std::size_t i = begin; i < end; ++i) {
+            try {
+                auto target = mid;
+                auto o = JNITypes<std::shared_ptr<Object>>::JNICast(env, receivers[i]);
+                std::shared_ptr<Class> owner;
+                auto cl = o ? o->getClassBorrowed(env, owner) : nullptr;
+                if(cl) {
+                    target = resolver.Resolve(env, cl, owner, mid);
+                }
+                BatchCall<T>::Invoke(env, target, receivers[i], args + i * stride, results ? results + i : nullptr);
+            } catch (...) {
+                auto cur = std::make_shared<Throwable>();
+                cur->except = std::current_exception();
+                env->current_exception = cur;
+            }
+            if(env->current_exception) {
+#ifdef JNI_TRACE
+                env->GetJNIEnv()->ExceptionDescribe();
+#endif
+                if(results) {
+                    results[i] = {};
+                }
+                return i;
+            }
+        }
+        return end;
+    }
+
+#ifdef EnableJNIVMGC
+    struct BatchChunk {
+        std::size_t begin;
+        std::size_t end;
+        std::size_t done;
+        std::shared_ptr<Throwable> exception;
+        // Returned objects, only referenced by the ENV of the worker until moved to the caller
+        std::vector<std::shared_ptr<Object>> objects;
+    };
+
+    template<class T> std::size_t CallBatchParallel(ENV* env, Method* mid, const jobject* receivers, std::size_t count, const jvalue* args, std::size_t stride, jvalue* results, std::size_t threads) {
+        bool objects = results && std::is_same<T, jobject>::value;
+        std::vector<BatchChunk> chunks(threads);
+        auto chunksize = (count + threads - 1) / threads;
+        for(std::size_t i = 0; i < threads; ++i) {
+            chunks[i].begin = std::min(count, i * chunksize);
+            chunks[i].end = std::min(count, chunks[i].begin + chunksize);
+        }
+        // Chunks run on the persistent workers of the VM, their ENVs stay attached between batches
+        auto&& executor = env->GetVM()->GetExecutor();
+        std::vector<std::future<void>> workers;
+        workers.reserve(threads - 1);
+        for(std::size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(executor.Submit([&, &chunk = chunks[i]](ENV* wenv) {
+                chunk.done = CallBatch<T>(wenv, mid, receivers, chunk.begin, chunk.end, args, stride, results);
+                chunk.exception = std::move(wenv->current_exception);
+                if(objects) {
+                    // Local references of the worker are released with its task frame
+                    chunk.objects.reserve(chunk.done - chunk.begin);
+                    for(std::size_t j = chunk.begin; j < chunk.done; ++j) {
+                        chunk.objects.emplace_back(JNITypes<std::shared_ptr<Object>>::JNICast(wenv, results[j].l));
+                    }
+                }
+            }));
+        }
+        auto&& first = chunks[0];
+        first.done = CallBatch<T>(env, mid, receivers, first.begin, first.end, args, stride, results);
+        // Every chunk references this frame, so wait for all of them before rethrowing
+        std::exception_ptr failure;
+        for(auto&& worker : workers) {
+            try {
+                executor.Wait(worker);
+            } catch(...) {
+                if(!failure) {
+                    failure = std::current_exception();
+                }
+            }
+        }
+        if(failure) {
+            std::rethrow_exception(failure);
+        }
+        for(std::size_t i = 1; i < threads; ++i) {
+            auto&& chunk = chunks[i];
+            for(std::size_t j = 0; j < chunk.objects.size(); ++j) {
+                auto&& obj = chunk.objects[j];
+                results[chunk.begin + j].l = (jobject)obj.get();
+                if(obj) {
+                    env->localrefs.Add(std::move(obj));
+                }
+            }
+        }
+        // Report the exception of the first failed call, like a sequential loop would
+        for(auto&& chunk : chunks) {
+            if(chunk.done != chunk.end) {
+                if(chunk.exception) {
+                    env->current_exception = std::move(chunk.exception);
+                }
+                return chunk.done;
+            }
+        }
+        return count;
+    }
+#endif
+
+    template<class T> std::size_t CallBatch(ENV* env, Method* mid, const jobject* receivers, std::size_t count, const jvalue* args, std::size_t stride, jvalue* results, std::size_t threads) {
+#ifdef EnableJNIVMGC
+        threads = std::min(threads, count / MinParallelChunk);
+        if(threads > 1 && mid->threadsafe && mid->nativehandle) {
+            // The calling thread takes the first chunk
+            threads = std::min(threads, env->GetVM()->GetExecutor().Threads() + 1);
+            return CallBatchParallel<T>(env, mid, receivers, count, args, stride, results, threads);
+        }
+#endif
+        return CallBatch<T>(env, mid, receivers, 0, count, args, stride, results);
+    }
+}
+
+std::size_t jnivm::ENV::CallMethodBatch(jmethodID id, const jobject* receivers, std::size_t count, const jvalue* args, std::size_t stride, jvalue* results, std::size_t threads) {
+    auto mid = (Method*)id;
+    if(!mid || (!receivers && count) || current_exception) {
+        return 0;
+    }
+#ifdef JNI_TRACE
+    LOG("JNIVM", "Call Member Function Batch Method=`%s` Signature=`%s` Count=`%zu`", mid->name.data(), mid->signature.data(), count);
+#endif
+    switch (mid->GetReturnKind()) {
+    case 'V':
+        return CallBatch<void>(this, mid, receivers, count, args, stride, results, threads);
+    case 'Z':
+        return CallBatch<jboolean>(this, mid, receivers, count, args, stride, results, threads);
+    case 'B':
+        return CallBatch<jbyte>(this, mid, receivers, count, args, stride, results, threads);
+    case 'S':
+        return CallBatch<jshort>(this, mid, receivers, count, args, stride, results, threads);
+    case 'C':
+        return CallBatch<jchar>(this, mid, receivers, count, args, stride, results, threads);
+    case 'I':
+        return CallBatch<jint>(this, mid, receivers, count, args, stride, results, threads);
+    case 'J':
+        return CallBatch<jlong>(this, mid, receivers, count, args, stride, results, threads);
+    case 'F':
+        return CallBatch<jfloat>(this, mid, receivers, count, args, stride, results, threads);
+    case 'D':
+        return CallBatch<jdouble>(this, mid, receivers, count, args, stride, results, threads);
+    case '[':
+    case 'L':
+        return CallBatch<jobject>(this, mid, receivers, count, args, stride, results, threads);
+    default:
+        throw std::runtime_error("Unsupported signature");
+    }
+}
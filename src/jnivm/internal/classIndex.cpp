@@ -0,0 +1,78 @@
+#include <jnivm/internal/classIndex.h>
+#include <cstring>
+
+using namespace jnivm;
+
+ClassIndex::ClassIndex() {
+    tables.emplace_back(NewTable(InitialSize));
+    current.store(tables.back().get(), std::memory_order_release);
+}
+
+std::unique_ptr<ClassIndex::Table> ClassIndex::NewTable(std::size_t size) {
+    std::unique_ptr<Table> table(new Table{ size - 1, std::unique_ptr<Bucket[]>(new Bucket[size]) });
+    for(std::size_t i = 0; i < size; ++i) {
+        table->buckets[i].hash.store(0, std::memory_order_relaxed);
+        table->buckets[i].entry.store(nullptr, std::memory_order_relaxed);
+    }
+    return table;
+}
+
+std::uint64_t ClassIndex::Hash(const char* name) {
+    // FNV-1a
+    std::uint64_t hash = 14695981039346656037ull;
+    for(; *name; ++name) {
+        hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+const ClassIndex::Entry* ClassIndex::Find(const char* name) const {
+    auto hash = Hash(name);
+    auto table = current.load(std::memory_order_acquire);
+    for(auto i = hash & table->mask;; i = (i + 1) & table->mask) {
+        auto&& bucket = table->buckets[i];
+        auto entry = bucket.entry.load(std::memory_order_acquire);
+        if(!entry) {
+            return nullptr;
+        }
+        // The hash is stored before the entry is released
+        if(bucket.hash.load(std::memory_order_relaxed) == hash && !strcmp(entry->first.data(), name)) {
+            return entry;
+        }
+    }
+}
+
+void ClassIndex::Insert(const Table& table, std::uint64_t hash, const Entry* entry) {
+    for(auto i = hash & table.mask;; i = (i + 1) & table.mask) {
+        auto&& bucket = table.buckets[i];
+        if(!bucket.entry.load(std::memory_order_relaxed)) {
+            bucket.hash.store(hash, std::memory_order_relaxed);
+            bucket.entry.store(entry, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+void ClassIndex::Publish(const Entry* entry) {
+    if(Find(entry->first.data())) {
+        return;
+    }
+    if((size + 1) * 2 > tables.back()->mask + 1) {
+        Grow();
+    }
+    Insert(*tables.back(), Hash(entry->first.data()), entry);
+    ++size;
+}
+
+void ClassIndex::Grow() {
+    auto&& old = *tables.back();
+    auto table = NewTable((old.mask + 1) * 2);
+    for(std::size_t i = 0; i <= old.mask; ++i) {
+        if(auto entry = old.buckets[i].entry.load(std::memory_order_relaxed)) {
+            Insert(*table, old.buckets[i].hash.load(std::memory_order_relaxed), entry);
+        }
+    }
+    // Readers still probing the old table finish there, it is complete up to this point
+    current.store(table.get(), std::memory_order_release);
+    tables.emplace_back(std::move(table));
+}
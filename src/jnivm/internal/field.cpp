@@ -10,21 +10,15 @@ using namespace jnivm;
 
 template<bool isStatic, bool ReturnNull, bool trace>
 jfieldID jnivm::GetFieldID(JNIEnv *env, jclass cl_, const char *name, const char *type) {
+    JNIVM_LOCK_CALLSITE(isStatic ? "GetStaticFieldID" : "GetFieldID");
     auto cl = JNITypes<std::shared_ptr<Class>>::JNICast(ENV::FromJNIEnv(env), cl_);
-    std::lock_guard<std::mutex> lock(cl->mtx);
+    std::lock_guard<ClassMutex> lock(cl->mtx);
     std::string &classname = cl->name;
 
     auto cur = cl;
-    auto sname = name;
-    auto ssig = type;
-    auto ccl =
-            std::find_if(cur->fields.begin(), cur->fields.end(),
-                                    [&sname, &ssig](std::shared_ptr<Field> &namesp) {
-                                        return namesp->_static == isStatic && namesp->name == sname && namesp->type == ssig;
-                                    });
-    std::shared_ptr<Field> next;
-    if (ccl != cur->fields.end()) {
-        next = *ccl;
+    constexpr MemberKind kind = isStatic ? MemberKind::Static : MemberKind::Instance;
+    Field* next = cur->FindField(name, type, kind);
+    if (next) {
 #ifdef JNI_TRACE
         LOG("JNIVM", "Found symbol, Class=`%s`, %sField=`%s`, Signature=`%s`", cl ? cl->nativeprefix.data() : nullptr, isStatic ? "Static" : "", name, type);
 #endif
@@ -47,11 +41,12 @@ jfieldID jnivm::GetFieldID(JNIEnv *env, jclass cl_, const char *name, const char
 #endif
             return nullptr;
         }
-        next = std::make_shared<Field>();
-        cur->fields.emplace_back(next);
-        next->name = std::move(sname);
-        next->type = std::move(ssig);
-        next->_static = isStatic;
+        auto field = std::make_shared<Field>();
+        field->name = name ? name : "";
+        field->type = type ? type : "";
+        field->_static = isStatic;
+        next = field.get();
+        cur->AddField(std::move(field));
 #ifdef JNI_DEBUG
         Declare(env, next->type.data());
 #endif
@@ -59,7 +54,7 @@ jfieldID jnivm::GetFieldID(JNIEnv *env, jclass cl_, const char *name, const char
         LOG("JNIVM", "Constructed Unresolved symbol, Class=`%s`, %sField=`%s`, Signature=`%s`", cl ? cl->nativeprefix.data() : nullptr, isStatic ? "Static" : "", name, type);
 #endif
     }
-    return (jfieldID)next.get();
+    return (jfieldID)next;
 };
 
 namespace Util {
@@ -85,22 +80,22 @@ namespace Util {
 
 template<bool> struct Caller {
     template<class T>
-    static T Get(jnivm::impl::MethodHandleBase<T>*p, ENV*env, jobject val) {
-        return p->InstanceGet(env, val, nullptr, {});
+    static T Get(jnivm::MethodHandle*p, ENV*env, jobject val) {
+        return p->InstanceGet<T>(env, val, nullptr);
     }
     template<class T>
-    static void Set(jnivm::impl::MethodHandleBase<T>*p, ENV*env, jobject val, jvalue* r) {
-        return p->InstanceSet(env, val, r, {});
+    static void Set(jnivm::MethodHandle*p, ENV*env, jobject val, jvalue* r) {
+        return p->InstanceSet<T>(env, val, r);
     }
 };
 template<> struct Caller<true> {
     template<class T>
-    static T Get(jnivm::impl::MethodHandleBase<T>*p, ENV*env, jnivm::Class* val) {
-        return p->StaticGet(env, val, nullptr, {});
+    static T Get(jnivm::MethodHandle*p, ENV*env, jnivm::Class* val) {
+        return p->StaticGet<T>(env, val, nullptr);
     }
     template<class T>
-    static void Set(jnivm::impl::MethodHandleBase<T>*p, ENV*env, jnivm::Class* val, jvalue* r) {
-        return p->StaticSet(env, val, r, {});
+    static void Set(jnivm::MethodHandle*p, ENV*env, jnivm::Class* val, jvalue* r) {
+        return p->StaticSet<T>(env, val, r);
     }
 };
 
@@ -126,7 +121,7 @@ template<bool RetNull, class T, class O> T jnivm::GetField(JNIEnv *env, O obj, j
         auto cl = Util::GetClass(ENV::FromJNIEnv(env), obj);
         LOG("JNIVM", "Invoked Unknown Field Getter Class=`%s` Field=`%s` Signature=`%s`", cl ? cl->nativeprefix.data() : "???", fid ? fid->name.data() : "???", fid ? fid->type.data() : "???");
 #endif
-        return defaultVal<T>(ENV::FromJNIEnv(env), fid ? fid->type : "");
+        return stubVal<T>(ENV::FromJNIEnv(env), fid ? &fid->stub : nullptr, fid ? fid->type.data() : nullptr);
     }
 }
 
@@ -155,6 +150,9 @@ template<class T, class O> void jnivm::SetField(JNIEnv *env, O obj, jfieldID id,
         auto cl = Util::GetClass(ENV::FromJNIEnv(env), obj);
         LOG("JNIVM", "Invoked Unknown Field Setter Class=`%s` Field=`%s` Signature=`%s`", cl ? cl->nativeprefix.data() : "???", fid ? fid->name.data() : "???", fid ? fid->type.data() : "???");
 #endif
+        if(fid) {
+            fid->stub.calls.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 }
 
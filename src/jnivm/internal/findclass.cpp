@@ -4,7 +4,38 @@
 #include <cstring>
 #include "log.h"
 
-std::shared_ptr<jnivm::Class> jnivm::InternalFindClass(ENV *env, const char *name, bool returnZero, bool trace) {
+namespace jnivm {
+namespace {
+
+// Requires classesmtx exclusively, keeps a class registered with the same name before
+const ClassIndex::Entry* Publish(VM* vm, std::shared_ptr<Class> cl) {
+	auto name = cl->nativeprefix;
+	auto res = vm->classes.emplace(std::move(name), cl);
+	if(res.second) {
+		// Owned by the VM until it is destroyed
+		cl->pinned.owner = vm->GetId();
+	}
+	// The class of a class is only written here, before other threads can find it via classindex
+	auto&& published = res.first->second;
+	if(published->clazz.expired()) {
+		auto meta = vm->classes.find("java/lang/Class");
+		if(meta == res.first) {
+			// Classes declared before java/lang/Class, only VM::initialize declares them before the VM is shared
+			for(auto&& entry : vm->classes) {
+				if(entry.second->clazz.expired()) {
+					entry.second->clazz = published;
+				}
+			}
+		} else if(meta != vm->classes.end()) {
+			published->clazz = meta->second;
+		}
+	}
+	vm->classindex.Publish(&*res.first);
+	return &*res.first;
+}
+
+// Returns the entry of the class in VM::classes, which is never moved or erased
+const std::shared_ptr<Class>* FindOrDeclare(ENV *env, const char *name, bool returnZero, bool trace) {
 	auto prefix = name;
 	auto && nenv = *env;
 	auto && vm = nenv.GetVM();
@@ -13,9 +44,15 @@ std::shared_ptr<jnivm::Class> jnivm::InternalFindClass(ENV *env, const char *nam
 		LOG("JNIVM", "FindClass %s", name);
 	}
 #endif
+	// Declared classes never change, so this is also valid for the namespace tree of JNI_DEBUG
+	if(auto entry = vm->classindex.Find(name)) {
+		return &entry->second;
+	}
 	std::shared_ptr<Class> curc = nullptr;
 #ifdef JNI_DEBUG
 	if(name[0] != '[') {
+		// The namespace tree is only walked and extended if the index misses, so for classes not declared yet
+		std::lock_guard<ClassesMutex> lock(vm->classesmtx);
 		// Generate the Namespace Hirachy to generate stub c++ files
 		// Makes it easier to implement classes without writing everthing by hand
 		auto end = name + strlen(name);
@@ -55,10 +92,10 @@ std::shared_ptr<jnivm::Class> jnivm::InternalFindClass(ENV *env, const char *nam
 				} else {
 					if(returnZero) return nullptr;
 					next = std::make_shared<Class>();
-					curc->classes.push_back(next);
 					next->name = std::move(sname);
 					next->nativeprefix = std::string(prefix, pos);
-					vm->classes[next->nativeprefix] = next;
+					next = Publish(vm, next)->second;
+					curc->classes.push_back(next);
 				}
 			} else {
 				auto cl = std::find_if(cur->classes.begin(), cur->classes.end(),
@@ -70,37 +107,52 @@ std::shared_ptr<jnivm::Class> jnivm::InternalFindClass(ENV *env, const char *nam
 				} else {
 					if(returnZero) return nullptr;
 					next = std::make_shared<Class>();
-					cur->classes.push_back(next);
 					next->name = std::move(sname);
 					next->nativeprefix = std::string(prefix, pos);
-					vm->classes[next->nativeprefix] = next;
+					next = Publish(vm, next)->second;
+					cur->classes.push_back(next);
 				}
 			}
 			curc = next;
 			name = pos + 1;
 		} while (pos != end);
+		return &Publish(vm, curc)->second;
 	} else {
 #endif
+	if(returnZero) {
+		// Entries inserted into classes without FindClass aren't published
+		std::shared_lock<ClassesMutex> lock(vm->classesmtx);
+		auto ccl = vm->classes.find(name);
+		return ccl != vm->classes.end() ? &ccl->second : nullptr;
+	}
+	std::lock_guard<ClassesMutex> lock(vm->classesmtx);
 	auto ccl = vm->classes.find(name);
 	if (ccl != vm->classes.end()) {
-		curc = ccl->second;
-	} else {
-		if(returnZero) return nullptr;
-		curc = std::make_shared<Class>();
-		const char * lastslash = strrchr(name, '/');
-		curc->name = lastslash != nullptr ? lastslash + 1 : name;
-		curc->nativeprefix = name;
-		vm->classes[name] = curc;
+		return &Publish(vm, ccl->second)->second;
 	}
+	curc = std::make_shared<Class>();
+	const char * lastslash = strrchr(name, '/');
+	curc->name = lastslash != nullptr ? lastslash + 1 : name;
+	curc->nativeprefix = name;
+	return &Publish(vm, curc)->second;
 #ifdef JNI_DEBUG
 	}
 #endif
-	// curc->nativeprefix = std::move(prefix);
-	return curc;
+}
+
+}
+}
+
+std::shared_ptr<jnivm::Class> jnivm::InternalFindClass(ENV *env, const char *name, bool returnZero, bool trace) {
+	auto cl = FindOrDeclare(env, name, returnZero, trace);
+	return cl ? *cl : nullptr;
 }
 
 jclass jnivm::InternalFindClass(JNIEnv *env, const char *name, bool returnZero, bool trace) {
-	return JNITypes<std::shared_ptr<Class>>::ToJNIType(ENV::FromJNIEnv(env), InternalFindClass(ENV::FromJNIEnv(env), name, returnZero, trace));
+	auto nenv = ENV::FromJNIEnv(env);
+	// Classes are pinned, a local reference to the entry doesn't touch its reference count
+	auto cl = FindOrDeclare(nenv, name, returnZero, trace);
+	return cl ? JNITypes<std::shared_ptr<Class>>::ToJNIType(nenv, *cl) : nullptr;
 }
 
 void jnivm::Declare(JNIEnv *env, const char *signature) {
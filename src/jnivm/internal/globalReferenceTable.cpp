@@ -0,0 +1,149 @@
+#include <jnivm.h>
+#include <jnivm/internal/globalReferenceTable.h>
+#include <jnivm/weak.h>
+#include <algorithm>
+
+using namespace jnivm;
+
+static_assert((GlobalReferenceTable::Shards & (GlobalReferenceTable::Shards - 1)) == 0, "Shards has to be a power of two");
+
+static std::size_t currentShard() {
+    static std::atomic<std::size_t> next { 0 };
+    // Threads are spread round robin, so concurrent threads rarely share a lock
+    static thread_local std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % GlobalReferenceTable::Shards;
+    return shard;
+}
+
+std::uint32_t GlobalReferenceTable::Insert(Shard& shard, std::size_t index, Entry entry) {
+    std::uint32_t slot;
+    if(shard.freelist.empty()) {
+        slot = static_cast<std::uint32_t>(shard.slots.size());
+        shard.slots.emplace_back(std::move(entry));
+    } else {
+        slot = shard.freelist.back();
+        shard.freelist.pop_back();
+        shard.slots[slot] = std::move(entry);
+    }
+    return slot * Shards + static_cast<std::uint32_t>(index);
+}
+
+std::size_t GlobalReferenceTable::SweepShard(Shard& shard, std::size_t budget) {
+    std::size_t released = 0;
+    budget = std::min(budget, shard.slots.size());
+    for(std::size_t i = 0; i < budget; ++i) {
+        if(shard.cursor >= shard.slots.size()) {
+            shard.cursor = 0;
+        }
+        auto&& entry = shard.slots[shard.cursor++];
+        if(entry.weak && !entry.dead && entry.weak->Sweep()) {
+            entry.dead = true;
+            ++shard.dead;
+            ++released;
+        }
+    }
+    return released;
+}
+
+void GlobalReferenceTable::Grown() {
+    auto peak = allocated.fetch_add(1, std::memory_order_relaxed) + 1;
+    if(onpeak) {
+        onpeak(peak);
+    }
+}
+
+std::uint32_t GlobalReferenceTable::Add(std::shared_ptr<Object> obj) {
+    auto index = currentShard();
+    auto&& shard = shards[index];
+    std::uint32_t id;
+    bool grown;
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        grown = shard.freelist.empty();
+        id = Insert(shard, index, { std::move(obj) });
+    }
+    if(grown) {
+        Grown();
+    }
+    return id;
+}
+
+std::uint32_t GlobalReferenceTable::AddWeak(std::shared_ptr<Weak> weak) {
+    auto index = currentShard();
+    auto&& shard = shards[index];
+    std::uint32_t id;
+    bool grown;
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        // Amortizes sweeping over creating weak references, dead ones can't pile up faster than new ones are created
+        SweepShard(shard, SweepPerWeak);
+        auto ptr = weak.get();
+        ++shard.weak;
+        grown = shard.freelist.empty();
+        id = Insert(shard, index, { std::move(weak), ptr });
+    }
+    if(grown) {
+        Grown();
+    }
+    return id;
+}
+
+bool GlobalReferenceTable::Remove(std::uint32_t id, const Object* obj) {
+    if(id == None) {
+        return false;
+    }
+    auto&& shard = shards[id % Shards];
+    auto slot = id / Shards;
+    std::shared_ptr<Object> ref;
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if(slot >= shard.slots.size() || !obj || shard.slots[slot].ref.get() != obj) {
+            return false;
+        }
+        auto&& entry = shard.slots[slot];
+        if(entry.weak) {
+            --shard.weak;
+            if(entry.dead) {
+                --shard.dead;
+            }
+        }
+        ref = std::move(entry.ref);
+        entry = {};
+        shard.freelist.push_back(slot);
+    }
+    // ref is released without holding the lock, its destructor may delete other global references
+    return true;
+}
+
+std::size_t GlobalReferenceTable::Sweep(std::size_t budget) {
+    auto&& shard = shards[nextsweep.fetch_add(1, std::memory_order_relaxed) % Shards];
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    return SweepShard(shard, budget);
+}
+
+std::size_t GlobalReferenceTable::Collect() {
+    std::size_t released = 0;
+    for(auto&& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        released += SweepShard(shard, shard.slots.size());
+    }
+    return released;
+}
+
+std::size_t GlobalReferenceTable::Size() {
+    std::size_t size = 0;
+    for(auto&& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        size += shard.slots.size() - shard.freelist.size();
+    }
+    return size;
+}
+
+GlobalReferenceTable::WeakStats GlobalReferenceTable::Weaks() {
+    WeakStats stats { 0, 0 };
+    for(auto&& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        stats.live += shard.weak - shard.dead;
+        stats.dead += shard.dead;
+    }
+    return stats;
+}
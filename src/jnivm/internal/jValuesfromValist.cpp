@@ -62,4 +62,44 @@ std::vector<jvalue> jnivm::JValuesfromValist(va_list list, const char* signature
 		signature++;
 	}
 	return values;
-}
\ No newline at end of file
+}
+
+void jnivm::JValuesfromValist(va_list list, const MethodSignature& signature, jvalue* values) {
+	for(char type : signature.parameters) {
+		switch (type) {
+		case 'Z':
+				// These are promoted to int (gcc warning)
+				values->z = (jboolean)va_arg(list, int);
+				break;
+		case 'B':
+				values->b = (jbyte)va_arg(list, int);
+				break;
+		case 'S':
+				values->s = (jshort)va_arg(list, int);
+				break;
+		case 'C':
+				values->c = (jchar)va_arg(list, int);
+				break;
+		case 'I':
+				values->i = va_arg(list, jint);
+				break;
+		case 'J':
+				values->j = va_arg(list, jlong);
+				break;
+		case 'F':
+				values->f = (jfloat)va_arg(list, jdouble);
+				break;
+		case 'D':
+				values->d = va_arg(list, jdouble);
+				break;
+		case 'L':
+				values->l = va_arg(list, jobject);
+				break;
+		default:
+				// Void has size 0 ignore it
+				values->j = 0;
+				break;
+		}
+		++values;
+	}
+}
@@ -0,0 +1,181 @@
+#include <jnivm/internal/localReferenceTable.h>
+#include <jnivm/object.h>
+#include <algorithm>
+
+using namespace jnivm;
+
+LocalReferenceTable::LocalReferenceTable() : frames({ { 0, None } }), buckets(16, Bucket{ nullptr, None }) {
+}
+
+std::size_t LocalReferenceTable::Find(const Object* obj) const {
+    for(auto i = BucketOf(obj);; i = (i + 1) & (buckets.size() - 1)) {
+        auto&& bucket = buckets[i];
+        if(bucket.key == obj) {
+            return i;
+        }
+        if(!bucket.key) {
+            return buckets.size();
+        }
+    }
+}
+
+void LocalReferenceTable::Erase(std::size_t bucket) {
+    // Backward shift deletion, keeps every probe sequence free of holes without tombstones
+    auto mask = buckets.size() - 1;
+    auto hole = bucket;
+    for(auto i = (bucket + 1) & mask; buckets[i].key; i = (i + 1) & mask) {
+        auto home = BucketOf(buckets[i].key);
+        // Move the entry into the hole, if the hole lies on its probe sequence
+        if(((i - home) & mask) >= ((i - hole) & mask)) {
+            buckets[hole] = buckets[i];
+            hole = i;
+        }
+    }
+    buckets[hole] = { nullptr, None };
+    --used;
+}
+
+void LocalReferenceTable::Rehash(std::size_t size) {
+    std::vector<Bucket> old(size, Bucket{ nullptr, None });
+    old.swap(buckets);
+    for(auto&& bucket : old) {
+        if(bucket.key) {
+            auto i = BucketOf(bucket.key);
+            while(buckets[i].key) {
+                i = (i + 1) & (buckets.size() - 1);
+            }
+            buckets[i] = bucket;
+        }
+    }
+}
+
+void LocalReferenceTable::Release(std::uint32_t index) {
+    auto&& slot = slots[index];
+    slot.ref = nullptr;
+    ++slot.generation;
+    --live;
+}
+
+bool LocalReferenceTable::Remove(Object* obj) {
+    auto bucket = obj ? Find(obj) : buckets.size();
+    if(bucket == buckets.size()) {
+        return false;
+    }
+    auto index = buckets[bucket].head;
+    auto&& slot = slots[index];
+    if(slot.next == None) {
+        Erase(bucket);
+    } else {
+        buckets[bucket].head = slot.next;
+    }
+    Release(index);
+    // Only the owning frame may reuse the slot, otherwise it would outlive PopFrame of a newer frame
+    auto frame = std::upper_bound(frames.begin(), frames.end(), index, [](std::uint32_t index, const Frame& frame) {
+        return index < frame.base;
+    }) - 1;
+    slot.next = frame->freelist;
+    frame->freelist = index;
+    return true;
+}
+
+bool LocalReferenceTable::Contains(Object* obj) const {
+    return obj && Find(obj) != buckets.size();
+}
+
+Object* LocalReferenceTable::Get(LocalRef ref) const {
+    if(ref.index >= top) {
+        return nullptr;
+    }
+    auto&& slot = slots[ref.index];
+    return slot.generation == ref.generation ? slot.ref.get() : nullptr;
+}
+
+void LocalReferenceTable::NewPeak() {
+    peak = live;
+    if(onpeak) {
+        onpeak(peak);
+    }
+}
+
+void LocalReferenceTable::PushFrame(std::size_t capacity) {
+    ++pushed;
+    frames.push_back({ top, None });
+    Reserve(capacity);
+}
+
+bool LocalReferenceTable::PopFrame() {
+    auto base = frames.back().base;
+    for(auto index = base; index < top; ++index) {
+        auto&& slot = slots[index];
+        if(!slot.ref) {
+            continue;
+        }
+        // All slots of the popped frame are newer than the ones of older frames, so they are at the start of the chain
+        auto bucket = Find(slot.ref.get());
+        // Another slot of the same object may already have unlinked all of them
+        if(bucket != buckets.size()) {
+            auto head = buckets[bucket].head;
+            while(head != None && head >= base) {
+                head = slots[head].next;
+            }
+            if(head == None) {
+                Erase(bucket);
+            } else {
+                buckets[bucket].head = head;
+            }
+        }
+        Release(index);
+    }
+    top = base;
+    // Hysteresis, a frame repeatedly filled just beyond retain doesn't reallocate on every pop
+    if(slots.capacity() > 2 * std::max<std::size_t>(retain, top)) {
+        Shrink();
+    }
+    if(frames.size() == 1) {
+        frames.back().freelist = None;
+        ++underflows;
+        return false;
+    }
+    frames.pop_back();
+    ++popped;
+    return true;
+}
+
+void LocalReferenceTable::Reset() {
+    while(PopFrame()) {
+    }
+    peak = 0;
+    pushed = 0;
+    popped = 0;
+    underflows = 0;
+    shrinks = 0;
+}
+
+void LocalReferenceTable::Shrink() {
+    // Slots above top are released, freelists of the remaining frames only point below top
+    slots.resize(std::min<std::size_t>(slots.size(), std::max<std::size_t>(retain, top)));
+    slots.shrink_to_fit();
+    std::size_t size = 16;
+    while(size < 4 * used) {
+        size *= 2;
+    }
+    if(size < buckets.size()) {
+        Rehash(size);
+    }
+    ++shrinks;
+}
+
+void LocalReferenceTable::Reserve(std::size_t capacity) {
+    if(top + capacity > slots.size()) {
+        slots.reserve(top + capacity);
+    }
+}
+
+LocalReferenceTable::Stats LocalReferenceTable::GetStats() const {
+    auto&& frame = frames.back();
+    std::size_t free = 0;
+    for(auto index = frame.freelist; index != None; index = slots[index].next) {
+        ++free;
+    }
+    return { live, peak, frames.size(), top - frame.base - free, pushed, popped, underflows, slots.capacity(), buckets.size(), shrinks };
+}
@@ -0,0 +1,198 @@
+#include <jnivm/internal/lockProfiler.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+using namespace jnivm;
+
+#ifdef EnableJNIVMLockProfiler
+namespace {
+    const char* const names[] = { "VM::classesmtx", "VM::typecheckmtx", "VM::envmtx", "VM::pinnedmtx", "VM::hookmtx", "Class::mtx", "Object monitor" };
+    const char outside[] = "(outside JNI)";
+    // Further callsites of a kind are counted as the last slot
+    constexpr std::size_t CallsiteSlots = 64;
+
+    struct CallsiteStats {
+        // Compared by address, names of the same JNI function in different translation units are merged by Collect
+        std::atomic<const char*> name { nullptr };
+        std::atomic<std::uint64_t> acquisitions { 0 };
+        std::atomic<std::uint64_t> contended { 0 };
+        std::atomic<std::uint64_t> waitns { 0 };
+    };
+
+    struct LockStats {
+        std::atomic<std::uint64_t> acquisitions { 0 };
+        std::atomic<std::uint64_t> contended { 0 };
+        std::atomic<std::uint64_t> waitns { 0 };
+        std::atomic<std::uint64_t> maxwaitns { 0 };
+        std::atomic<std::uint64_t> histogram[LockProfile::Buckets];
+        CallsiteStats callsites[CallsiteSlots];
+
+        LockStats() {
+            for(auto&& bucket : histogram) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    LockStats stats[(int)LockKind::Count];
+    thread_local const char* currentcallsite = nullptr;
+
+    std::size_t Bucket(std::uint64_t waitns) {
+        auto us = waitns / 1000;
+        std::size_t bucket = 0;
+        while(us && bucket + 1 < LockProfile::Buckets) {
+            us >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    CallsiteStats& FindCallsite(LockStats& lock, const char* name) {
+        auto hash = reinterpret_cast<std::uintptr_t>(name) >> 4;
+        for(std::size_t i = 0; i < CallsiteSlots; ++i) {
+            auto&& slot = lock.callsites[(hash + i) % CallsiteSlots];
+            auto current = slot.name.load(std::memory_order_acquire);
+            if(current == name) {
+                return slot;
+            }
+            if(!current && (slot.name.compare_exchange_strong(current, name, std::memory_order_acq_rel) || current == name)) {
+                return slot;
+            }
+        }
+        return lock.callsites[CallsiteSlots - 1];
+    }
+}
+
+LockCallsite::LockCallsite(const char* name) : previous(currentcallsite) {
+    if(!previous) {
+        currentcallsite = name;
+    }
+}
+
+LockCallsite::~LockCallsite() {
+    currentcallsite = previous;
+}
+
+void lockprofiler::Record(LockKind kind, bool contended, std::uint64_t waitns) {
+    auto&& lock = stats[(int)kind];
+    lock.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    lock.histogram[Bucket(waitns)].fetch_add(1, std::memory_order_relaxed);
+    auto&& callsite = FindCallsite(lock, currentcallsite ? currentcallsite : outside);
+    callsite.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if(contended) {
+        lock.contended.fetch_add(1, std::memory_order_relaxed);
+        lock.waitns.fetch_add(waitns, std::memory_order_relaxed);
+        callsite.contended.fetch_add(1, std::memory_order_relaxed);
+        callsite.waitns.fetch_add(waitns, std::memory_order_relaxed);
+        auto max = lock.maxwaitns.load(std::memory_order_relaxed);
+        while(max < waitns && !lock.maxwaitns.compare_exchange_weak(max, waitns, std::memory_order_relaxed));
+    }
+}
+#endif
+
+std::uint64_t lockprofiler::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<LockProfile> lockprofiler::Collect() {
+    std::vector<LockProfile> profiles;
+#ifdef EnableJNIVMLockProfiler
+    for(int kind = 0; kind < (int)LockKind::Count; ++kind) {
+        auto&& lock = stats[kind];
+        LockProfile profile;
+        profile.acquisitions = lock.acquisitions.load(std::memory_order_relaxed);
+        if(!profile.acquisitions) {
+            continue;
+        }
+        profile.name = names[kind];
+        profile.contended = lock.contended.load(std::memory_order_relaxed);
+        profile.waitns = lock.waitns.load(std::memory_order_relaxed);
+        profile.maxwaitns = lock.maxwaitns.load(std::memory_order_relaxed);
+        for(std::size_t i = 0; i < LockProfile::Buckets; ++i) {
+            profile.histogram[i] = lock.histogram[i].load(std::memory_order_relaxed);
+        }
+        for(auto&& slot : lock.callsites) {
+            auto name = slot.name.load(std::memory_order_acquire);
+            if(!name) {
+                continue;
+            }
+            auto callsite = std::find_if(profile.callsites.begin(), profile.callsites.end(), [name](const LockProfile::Callsite& c) {
+                return c.name == name;
+            });
+            if(callsite == profile.callsites.end()) {
+                profile.callsites.emplace_back();
+                callsite = profile.callsites.end() - 1;
+                callsite->name = name;
+            }
+            callsite->acquisitions += slot.acquisitions.load(std::memory_order_relaxed);
+            callsite->contended += slot.contended.load(std::memory_order_relaxed);
+            callsite->waitns += slot.waitns.load(std::memory_order_relaxed);
+        }
+        std::sort(profile.callsites.begin(), profile.callsites.end(), [](const LockProfile::Callsite& a, const LockProfile::Callsite& b) {
+            return a.waitns != b.waitns ? a.waitns > b.waitns : a.acquisitions > b.acquisitions;
+        });
+        profiles.emplace_back(std::move(profile));
+    }
+    std::sort(profiles.begin(), profiles.end(), [](const LockProfile& a, const LockProfile& b) {
+        return a.waitns != b.waitns ? a.waitns > b.waitns : a.acquisitions > b.acquisitions;
+    });
+#endif
+    return profiles;
+}
+
+void lockprofiler::Reset() {
+#ifdef EnableJNIVMLockProfiler
+    for(auto&& lock : stats) {
+        lock.acquisitions.store(0, std::memory_order_relaxed);
+        lock.contended.store(0, std::memory_order_relaxed);
+        lock.waitns.store(0, std::memory_order_relaxed);
+        lock.maxwaitns.store(0, std::memory_order_relaxed);
+        for(auto&& bucket : lock.histogram) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        for(auto&& slot : lock.callsites) {
+            slot.name.store(nullptr, std::memory_order_release);
+            slot.acquisitions.store(0, std::memory_order_relaxed);
+            slot.contended.store(0, std::memory_order_relaxed);
+            slot.waitns.store(0, std::memory_order_relaxed);
+        }
+    }
+#endif
+}
+
+std::string lockprofiler::Format(const std::vector<LockProfile>& profiles) {
+#ifndef EnableJNIVMLockProfiler
+    (void)profiles;
+    return "Lock profiler disabled, build jnivm with JNIVM_ENABLE_LOCK_PROFILER\n";
+#else
+    std::string report;
+    char line[256];
+    snprintf(line, sizeof(line), "%-32s %12s %12s %12s %12s\n", "Lock / Callsite", "Acquired", "Contended", "Wait us", "Max us");
+    report += line;
+    for(auto&& profile : profiles) {
+        snprintf(line, sizeof(line), "%-32s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n", profile.name.data(), profile.acquisitions, profile.contended, profile.waitns / 1000, profile.maxwaitns / 1000);
+        report += line;
+        for(auto&& callsite : profile.callsites) {
+            snprintf(line, sizeof(line), "  %-30s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n", callsite.name.data(), callsite.acquisitions, callsite.contended, callsite.waitns / 1000);
+            report += line;
+        }
+        report += "  Wait histogram:";
+        for(std::size_t i = 0; i < LockProfile::Buckets; ++i) {
+            if(profile.histogram[i]) {
+                if(i + 1 < LockProfile::Buckets) {
+                    snprintf(line, sizeof(line), " <%" PRIu64 "us: %" PRIu64, std::uint64_t(1) << i, profile.histogram[i]);
+                } else {
+                    snprintf(line, sizeof(line), " >=%" PRIu64 "us: %" PRIu64, std::uint64_t(1) << (i - 1), profile.histogram[i]);
+                }
+                report += line;
+            }
+        }
+        report += "\n";
+    }
+    return report;
+#endif
+}
@@ -1,20 +1,22 @@
 #include "method.h"
 #include "log.h"
 #include <jnivm/internal/jValuesfromValist.h>
+#include <cstring>
 
 using namespace jnivm;
 
 template<bool isStatic, bool ReturnNull, bool AllowNative, bool trace>
 jmethodID jnivm::GetMethodID(JNIEnv *env, jclass cl, const char *str0, const char *str1) {
-    std::shared_ptr<Method> next;
-    std::string sname = str0 ? str0 : "";
-    std::string ssig = str1 ? str1 : "";
+    JNIVM_LOCK_CALLSITE(isStatic ? "GetStaticMethodID" : "GetMethodID");
+    Method* next = nullptr;
+    constexpr MemberKind kind = AllowNative ? MemberKind::Native : isStatic ? MemberKind::Static : MemberKind::Instance;
     auto cur = JNITypes<std::shared_ptr<Class>>::JNICast(ENV::FromJNIEnv(env), cl);
     if(cur) {
         // Rewrite init to Static external function
-        if(!isStatic && sname == "<init>") {
+        if(!isStatic && str0 && !strcmp(str0, "<init>")) {
+            std::string ssig = str1 ? str1 : "";
             {
-                std::lock_guard<std::mutex> lock(cur->mtx);
+                std::lock_guard<ClassMutex> lock(cur->mtx);
                 auto acbrack = ssig.find(')') + 1;
                 ssig.erase(acbrack, std::string::npos);
                 ssig.append("L");
@@ -24,16 +26,8 @@ jmethodID jnivm::GetMethodID(JNIEnv *env, jclass cl, const char *str0, const cha
             return GetMethodID<true, ReturnNull, AllowNative, trace>(env, cl, str0, ssig.data());
         }
         else {
-            std::lock_guard<std::mutex> lock(cur->mtx);
-            std::string &classname = cur->name;
-            auto ccl =
-                    std::find_if(cur->methods.begin(), cur->methods.end(),
-                                            [&sname, &ssig](std::shared_ptr<Method> &namesp) {
-                                                return namesp->_static == isStatic && AllowNative == (bool)namesp->native && namesp->name == sname && namesp->signature == ssig;
-                                            });
-            if (ccl != cur->methods.end()) {
-                next = *ccl;
-            }
+            std::lock_guard<ClassMutex> lock(cur->mtx);
+            next = cur->FindMethod(str0, str1, kind);
         }
     } else {
 #ifdef JNI_DEBUG
@@ -59,16 +53,19 @@ jmethodID jnivm::GetMethodID(JNIEnv *env, jclass cl, const char *str0, const cha
 #endif
             return nullptr;
         }
-        next = std::make_shared<Method>();
+        auto method = std::make_shared<Method>(str0 ? str0 : "", str1 ? str1 : "", isStatic);
+        next = method.get();
         if(cur) {
-            cur->methods.push_back(next);
+            std::lock_guard<ClassMutex> lock(cur->mtx);
+            // Another thread may have constructed the same symbol in the meantime
+            if(auto m = cur->FindMethod(method->name, method->signature, method->GetKind())) {
+                return (jmethodID)m;
+            }
+            cur->AddMethod(std::move(method));
         } else {
             // For Debugging purposes without valid parent class
-            JNITypes<std::shared_ptr<Method>>::ToJNIType(ENV::FromJNIEnv(env), next);
+            JNITypes<std::shared_ptr<Method>>::ToJNIType(ENV::FromJNIEnv(env), method);
         }
-        next->name = std::move(sname);
-        next->signature = std::move(ssig);
-        next->_static = isStatic;
 #ifdef JNI_DEBUG
         Declare(env, next->signature.data());
 #endif
@@ -80,112 +77,156 @@ jmethodID jnivm::GetMethodID(JNIEnv *env, jclass cl, const char *str0, const cha
         LOG("JNIVM", "Found symbol, Class=`%s`, %sMethod=`%s`, Signature=`%s`", cur ? cur->nativeprefix.data() : nullptr, AllowNative ? "Native" : isStatic ? "Static" : "", str0, str1);
 #endif
     }
-    return (jmethodID)next.get();
+    return (jmethodID)next;
 };
 
-template<class T> T jnivm::defaultVal(ENV* env, std::string signature) {
+template<class T> T jnivm::defaultVal(ENV* env, const char* type) {
     return {};
 }
-template<> void jnivm::defaultVal(ENV* env, std::string signature) {
+template<> void jnivm::defaultVal(ENV* env, const char* type) {
 }
 
-template<> jobject jnivm::defaultVal(ENV* env, std::string signature) {
 #ifdef JNI_RETURN_NON_ZERO
-    if(!signature.empty()) {
-        size_t off = signature.find_last_of(")");
-        if(signature[off + 1] == '[' ){
+// Computes the part of the return value of type, which can be reused by every call
+static void fillStub(ENV* env, StubValue& stub, const char* type) {
+    if(type && *type) {
+        size_t length = strlen(type);
+        if(type[0] == '[' ){
 #ifdef JNI_TRACE
-            LOG("JNIVM", "Construct array=`%s` via New*Array", &signature.data()[off + 1]);
+            LOG("JNIVM", "Construct array=`%s` via New*Array", type);
 #endif
-            switch (signature[off + 2])
+            jarray array = nullptr;
+            switch (type[1])
             {
+            case 'Z':
+                array = env->GetJNIEnv()->NewBooleanArray(0);
+                break;
             case 'B':
-                return env->GetJNIEnv()->NewByteArray(0);
+                array = env->GetJNIEnv()->NewByteArray(0);
+                break;
             case 'S':
-                return env->GetJNIEnv()->NewShortArray(0);
+                array = env->GetJNIEnv()->NewShortArray(0);
+                break;
             case 'C':
-                return env->GetJNIEnv()->NewCharArray(0);
+                array = env->GetJNIEnv()->NewCharArray(0);
+                break;
             case 'I':
-                return env->GetJNIEnv()->NewIntArray(0);
+                array = env->GetJNIEnv()->NewIntArray(0);
+                break;
             case 'J':
-                return env->GetJNIEnv()->NewLongArray(0);
+                array = env->GetJNIEnv()->NewLongArray(0);
+                break;
             case 'F':
-                return env->GetJNIEnv()->NewFloatArray(0);
+                array = env->GetJNIEnv()->NewFloatArray(0);
+                break;
             case 'D':
-                return env->GetJNIEnv()->NewDoubleArray(0);
+                array = env->GetJNIEnv()->NewDoubleArray(0);
+                break;
             case 'L':
             case '[':
-                return env->GetJNIEnv()->NewObjectArray(0, env->GetJNIEnv()->FindClass(signature[off + 2] == 'L' && signature[signature.size() - 1] == ';' ? signature.substr(off + 3, signature.size() - (off + 4)).data() : &signature.data()[off + 1]), nullptr);
+                array = env->GetJNIEnv()->NewObjectArray(0, env->GetJNIEnv()->FindClass(type[1] == 'L' && type[length - 1] == ';' ? std::string(type + 2, length - 3).data() : type + 1), nullptr);
+                break;
             default:
 #ifdef JNI_TRACE
-            LOG("JNIVM", "Constructing array=`%s` failed unknown type", &signature.data()[off + 1]);
+                LOG("JNIVM", "Constructing array=`%s` failed unknown type", type);
 #endif
                 break;
             }
-            
-        } else if(signature[off + 1] == 'L' && signature[signature.size() - 1] == ';'){
-            auto c = env->GetClass(signature.substr(off + 2, signature.size() - (off + 3)).data());
-            if(c->Instantiate) {
-#ifdef JNI_TRACE
-                LOG("JNIVM", "Construct object=`%s` via default constructor", &signature.data()[off + 1]);
-#endif
-                return JNITypes<std::shared_ptr<Object>>::ToJNIReturnType(env, c->Instantiate(env));
-            } else {
-                std::lock_guard<std::mutex> guard(env->GetVM()->mtx);
-                bool safetocreatedummy = true;
-                for(auto&& ty : env->GetVM()->typecheck) {
-                    if(ty.second == c) {
-                        safetocreatedummy = false;
-                        break;
-                    }
-                }
-                if(safetocreatedummy) {
-#ifdef JNI_TRACE
-                    LOG("JNIVM", "Construct dummy object=`%s`, no native type attached to this Class", &signature.data()[off + 1]);
-#endif
-                    auto dummy = std::make_shared<Object>();
-                    dummy->clazz = c;
-                    return JNITypes<std::shared_ptr<Object>>::ToJNIReturnType(env, dummy);
-                } else {
+            if(array) {
+                stub.value = JNITypes<std::shared_ptr<Object>>::JNICast(env, array);
+                env->GetJNIEnv()->DeleteLocalRef(array);
+            }
+        } else if(type[0] == 'L' && type[length - 1] == ';'){
+            auto clazz = env->GetClass(std::string(type + 1, length - 2).data());
+            stub.clazz = clazz;
+            if(!clazz->Instantiate && !clazz->nativetype) {
 #ifdef JNI_TRACE
-                    LOG("JNIVM", "You have to create a default constructor for object=`%s` to get a non zero return value", &signature.data()[off + 1]);
+                LOG("JNIVM", "Construct dummy object=`%s`, no native type attached to this Class", type);
 #endif
-                }
+                auto dummy = std::make_shared<Object>();
+                dummy->clazz = clazz;
+                stub.value = std::move(dummy);
             }
         }
+    }
+}
+
+// Returns the cached value of stub or instantiates a new object if the class has a native type
+static jobject stubObject(ENV* env, const StubValue& stub, const char* type) {
+    if(auto clazz = stub.clazz.lock()) {
+        if(clazz->Instantiate) {
 #ifdef JNI_TRACE
-        LOG("JNIVM", "Failed to construct return value of signature=`%s`", signature.data());
+            LOG("JNIVM", "Construct object=`%s` via default constructor", type);
 #endif
-    } else {
+            return JNITypes<std::shared_ptr<Object>>::ToJNIReturnType(env, clazz->Instantiate(env));
+        }
+        if(stub.value && !clazz->nativetype) {
+            return JNITypes<std::shared_ptr<Object>>::ToJNIReturnType(env, stub.value);
+        }
 #ifdef JNI_TRACE
-        LOG("JNIVM", "Failed to guess return value of empty signature");
+        LOG("JNIVM", "You have to create a default constructor for object=`%s` to get a non zero return value", type);
 #endif
+    } else if(stub.value) {
+        return JNITypes<std::shared_ptr<Object>>::ToJNIReturnType(env, stub.value);
     }
+#ifdef JNI_TRACE
+    LOG("JNIVM", "Failed to construct return value of type=`%s`", type ? type : "");
+#endif
+    return nullptr;
+}
 #endif
+
+template<> jobject jnivm::defaultVal(ENV* env, const char* type) {
+#ifdef JNI_RETURN_NON_ZERO
+    StubValue stub;
+    fillStub(env, stub, type);
+    return stubObject(env, stub, type);
+#else
     return nullptr;
+#endif
 }
 
-static Method* findNonVirtualOverload(Class*cl, Method*mid) {
-    if(!cl) {
-        return mid;
+template<class T> T jnivm::stubVal(ENV* env, Stub* stub, const char* type) {
+    if(stub) {
+        stub->calls.fetch_add(1, std::memory_order_relaxed);
     }
-    auto res = std::find_if(cl->methods.begin(), cl->methods.end(), [mid](auto&& m) {
-        return !m->_static && mid->name == m->name && mid->signature == m->signature && m->nativehandle;
-    });
-    if(res != cl->methods.end()) {
-        return res->get();
-    } else {
-        return nullptr;
+    return defaultVal<T>(env, type);
+}
+
+template<> void jnivm::stubVal(ENV* env, Stub* stub, const char* type) {
+    if(stub) {
+        stub->calls.fetch_add(1, std::memory_order_relaxed);
     }
 }
 
-static Method* findVirtualOverload(jnivm::ENV *env, Class*cl, Method*mid) {
-    auto r = findNonVirtualOverload(cl, mid);
-    if(r != nullptr) {
-        return r;
-    } else {
-        return findVirtualOverload(env, mid->GetBaseClasses(env)[0].get(), mid);
+template<> jobject jnivm::stubVal(ENV* env, Stub* stub, const char* type) {
+    if(!stub) {
+        return defaultVal<jobject>(env, type);
     }
+    stub->calls.fetch_add(1, std::memory_order_relaxed);
+#ifdef JNI_RETURN_NON_ZERO
+    auto cached = stub->cached.load(std::memory_order_acquire);
+    if(!cached) {
+        // Threads racing on the first call fill their own value, only one of them is kept
+        std::unique_ptr<StubValue> value(new StubValue());
+        fillStub(env, *value, type);
+        if(stub->cached.compare_exchange_strong(cached, value.get(), std::memory_order_acq_rel)) {
+            cached = value.release();
+        }
+    }
+    return stubObject(env, *cached, type);
+#else
+    return nullptr;
+#endif
+}
+
+static Method* findNonVirtualOverload(Class*cl, Method*mid) {
+    if(!cl) {
+        return mid;
+    }
+    std::lock_guard<ClassMutex> lock(cl->mtx);
+    auto res = cl->FindMethod(mid->name, mid->signature, MemberKind::Instance);
+    return res && res->nativehandle ? res : nullptr;
 }
 
 template<class T> T jnivm::MDispatchBase2<T>::CallMethod(JNIEnv *env, jobject obj, jmethodID id, jvalue *param) {
@@ -197,13 +238,18 @@ template<class T> T jnivm::MDispatchBase2<T>::CallMethod(JNIEnv *env, jobject ob
         LOG("JNIVM", "CallMethod field is null");
 #endif
     if (mid && mid->nativehandle) {
-        auto cl = JNITypes<std::shared_ptr<Class>>::JNICast(ENV::FromJNIEnv(env), env->GetObjectClass(obj));
-        mid = findVirtualOverload(ENV::FromJNIEnv(env), cl.get(), mid);
+        auto o = JNITypes<std::shared_ptr<Object>>::JNICast(ENV::FromJNIEnv(env), obj);
+        std::shared_ptr<Class> owner;
+        auto cl = o ? o->getClassBorrowed(ENV::FromJNIEnv(env), owner) : nullptr;
+        if(cl) {
+            JNIVM_LOCK_CALLSITE("Call<Type>Method");
+            mid = cl->GetVirtualOverride(ENV::FromJNIEnv(env), mid);
+        }
 #ifdef JNI_TRACE
         LOG("JNIVM", "Call Member Function Class=`%s` Method=`%s` Signature=`%s`", cl ? cl->nativeprefix.data() : "???", mid->name.data(), mid->signature.data());
 #endif
         try {
-            return static_cast<jnivm::impl::MethodHandleBase<T>*>(mid->nativehandle.get())->InstanceInvoke(ENV::FromJNIEnv(env), obj, param, jnivm::impl::MethodHandleBase<T>{});
+            return mid->nativehandle->InstanceInvoke<T>(ENV::FromJNIEnv(env), obj, param);
         } catch (...) {
             auto cur = std::make_shared<Throwable>();
             cur->except = std::current_exception();
@@ -211,25 +257,31 @@ template<class T> T jnivm::MDispatchBase2<T>::CallMethod(JNIEnv *env, jobject ob
 #ifdef JNI_TRACE
             env->ExceptionDescribe();
 #endif
-            return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->signature : "");
+            return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->GetReturnType() : nullptr);
         }
     } else {
 #ifdef JNI_TRACE
         auto cl = JNITypes<std::shared_ptr<Class>>::JNICast(ENV::FromJNIEnv(env), env->GetObjectClass(obj));
         LOG("JNIVM", "Call Unknown Member Function Class=`%s` Method=`%s` Signature=`%s`", cl ? cl->nativeprefix.data() : "???", mid ? mid->name.data() : "???", mid ? mid->signature.data() : "???");
 #endif
-        return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->signature : "");
+        return stubVal<T>(ENV::FromJNIEnv(env), mid ? &mid->stub : nullptr, mid ? mid->GetReturnType() : nullptr);
     }
 };
 
 template<class T, class... Y> T jnivm::MDispatchBase<T, Y...>::CallMethod(JNIEnv *env, Y ...p, jmethodID id, va_list param) {
     if(id) {
-        return MDispatch<T, Y...>::CallMethod(env, p..., id, JValuesfromValist(param, ((Method *)id)->signature.data()).data());
+        auto mid = (Method *)id;
+        if(mid->parsedsignature.valid) {
+            jvalue values[MethodSignature::MaxParameters];
+            JValuesfromValist(param, mid->parsedsignature, values);
+            return MDispatch<T, Y...>::CallMethod(env, p..., id, values);
+        }
+        return MDispatch<T, Y...>::CallMethod(env, p..., id, JValuesfromValist(param, mid->signature.data()).data());
     } else {
 #ifdef JNI_TRACE
         LOG("JNIVM", "CallMethod Method ID is null");
 #endif
-        return defaultVal<T>(ENV::FromJNIEnv(env), "");
+        return defaultVal<T>(ENV::FromJNIEnv(env), nullptr);
     }
 };
 
@@ -263,9 +315,12 @@ template<class T> T jnivm::MDispatchBase2<T>::CallMethod(JNIEnv *env, jobject ob
 #ifdef JNI_TRACE
         LOG("JNIVM", "Call NonVirtual Member Function Class=`%s` Method=`%s` Signature=`%s`", clz ? clz->nativeprefix.data() : "???", mid->name.data(), mid ? mid->signature.data() : "???");
 #endif
-        mid = findNonVirtualOverload(clz.get(), mid);
+        {
+            JNIVM_LOCK_CALLSITE("CallNonvirtual<Type>Method");
+            mid = findNonVirtualOverload(clz.get(), mid);
+        }
         try {
-            return static_cast<jnivm::impl::MethodHandleBase<T>*>(mid->nativehandle.get())->NonVirtualInstanceInvoke(ENV::FromJNIEnv(env), obj, param, jnivm::impl::MethodHandleBase<T>{});
+            return mid->nativehandle->NonVirtualInstanceInvoke<T>(ENV::FromJNIEnv(env), obj, param);
         } catch (...) {
             auto cur = std::make_shared<Throwable>();
             cur->except = std::current_exception();
@@ -273,14 +328,14 @@ template<class T> T jnivm::MDispatchBase2<T>::CallMethod(JNIEnv *env, jobject ob
 #ifdef JNI_TRACE
             env->ExceptionDescribe();
 #endif
-            return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->signature : "");
+            return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->GetReturnType() : nullptr);
         }
     } else {
 #ifdef JNI_TRACE
         auto clz = JNITypes<std::shared_ptr<Class>>::JNICast(ENV::FromJNIEnv(env), cl);
         LOG("JNIVM", "Call Unknown NonVirtual Member Function Class=`%s` Method=`%s` Signature=`%s`", clz ? clz->nativeprefix.data() : "???", mid ? mid->name.data() : "???", mid ? mid->signature.data() : "???");
 #endif
-        return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->signature : "");
+        return stubVal<T>(ENV::FromJNIEnv(env), mid ? &mid->stub : nullptr, mid ? mid->GetReturnType() : nullptr);
     }
 };
 
@@ -298,7 +353,7 @@ template<class T> T jnivm::MDispatchBase2<T>::CallMethod(JNIEnv *env, jclass _cl
         LOG("JNIVM", "Call Static Function Class=`%s` Method=`%s` Signature=`%s`", cl ? cl->nativeprefix.data() : "???", mid->name.data(), mid ? mid->signature.data() : "???");
 #endif
         try {
-             return static_cast<jnivm::impl::MethodHandleBase<T>*>(mid->nativehandle.get())->StaticInvoke(ENV::FromJNIEnv(env), cl.get(), param, jnivm::impl::MethodHandleBase<T>{});
+             return mid->nativehandle->StaticInvoke<T>(ENV::FromJNIEnv(env), cl.get(), param);
         } catch (...) {
             auto cur = std::make_shared<Throwable>();
             cur->except = std::current_exception();
@@ -306,13 +361,13 @@ template<class T> T jnivm::MDispatchBase2<T>::CallMethod(JNIEnv *env, jclass _cl
 #ifdef JNI_TRACE
             env->ExceptionDescribe();
 #endif
-            return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->signature : "");
+            return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->GetReturnType() : nullptr);
         }
     } else {
 #ifdef JNI_TRACE
         LOG("JNIVM", "Call Unknown Static Function Class=`%s` Method=`%s` Signature=`%s`", cl ? cl->nativeprefix.data() : "???", mid ? mid->name.data() : "???", mid ? mid->signature.data() : "???");
 #endif
-        return defaultVal<T>(ENV::FromJNIEnv(env), mid ? mid->signature : "");
+        return stubVal<T>(ENV::FromJNIEnv(env), mid ? &mid->stub : nullptr, mid ? mid->GetReturnType() : nullptr);
     }
 };
 
@@ -344,7 +399,8 @@ DeclareTemplate(jobject);
 DeclareTemplate(void);
 #undef DeclareTemplate
 
-#define DeclareTemplate(T) template T jnivm::defaultVal(ENV* env, std::string signature)
+#define DeclareTemplate(T) template T jnivm::defaultVal(ENV* env, const char* type); \
+                           template T jnivm::stubVal(ENV* env, Stub* stub, const char* type)
 DeclareTemplate(jboolean);
 DeclareTemplate(jbyte);
 DeclareTemplate(jshort);
@@ -8,9 +8,14 @@ namespace jnivm {
     template<bool isStatic, bool ReturnNull = false, bool AllowNative = false, bool trace = true>
     jmethodID GetMethodID(JNIEnv *env, jclass cl, const char *str0, const char *str1);
 
-    template<class T> T defaultVal(ENV* env, std::string signature);
-    template<> void defaultVal(ENV* env, std::string signature);
-    template<> jobject defaultVal(ENV* env, std::string signature);
+    // type is the jni return or field type like "I" or "Ljava/lang/String;", may be nullptr
+    template<class T> T defaultVal(ENV* env, const char* type);
+    template<> void defaultVal(ENV* env, const char* type);
+    template<> jobject defaultVal(ENV* env, const char* type);
+    // Like defaultVal, but counts the call and caches the return value in stub, stub may be nullptr
+    template<class T> T stubVal(ENV* env, Stub* stub, const char* type);
+    template<> void stubVal(ENV* env, Stub* stub, const char* type);
+    template<> jobject stubVal(ENV* env, Stub* stub, const char* type);
 
     template <class T, class...Y> struct MDispatchBase {
         static T CallMethod(JNIEnv * env, Y...p, jmethodID id, va_list param);
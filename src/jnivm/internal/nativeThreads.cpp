@@ -0,0 +1,44 @@
+#include <jnivm/internal/nativeThreads.h>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+using namespace jnivm;
+
+void NativeThreads::Start(std::function<void()> f) {
+    auto finished = std::make_shared<std::atomic<bool>>(false);
+    std::thread thread([f = std::move(f), finished]() {
+        f();
+        finished->store(true, std::memory_order_release);
+    });
+    std::vector<Started> done;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto running = std::partition(threads.begin(), threads.end(), [](const Started& started) {
+            return !started.finished->load(std::memory_order_acquire);
+        });
+        std::move(running, threads.end(), std::back_inserter(done));
+        threads.erase(running, threads.end());
+        threads.push_back({ std::move(thread), std::move(finished) });
+    }
+    // Only about to return, so joined without holding mtx
+    for(auto&& started : done) {
+        started.thread.join();
+    }
+}
+
+NativeThreads::~NativeThreads() {
+    while(true) {
+        std::vector<Started> running;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if(threads.empty()) {
+                break;
+            }
+            running.swap(threads);
+        }
+        for(auto&& started : running) {
+            started.thread.join();
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#include <jnivm/internal/objectLock.h>
+#include <jnivm/internal/lockProfiler.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace jnivm;
+
+struct ObjectLock::Monitor {
+    std::mutex mtx;
+    // Threads waiting to enter
+    std::condition_variable entry;
+    // Threads in Wait
+    std::condition_variable waiters;
+    std::uintptr_t owner = 0;
+    std::size_t count = 0;
+
+    // Returns true if another thread owned the monitor
+    bool Enter(std::uintptr_t token) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if(owner == token) {
+            ++count;
+            return false;
+        }
+        auto owned = owner != 0;
+        entry.wait(lock, [this]() { return !owner; });
+        owner = token;
+        count = 1;
+        return owned;
+    }
+
+    bool TryEnter(std::uintptr_t token) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(owner && owner != token) {
+            return false;
+        }
+        owner = token;
+        ++count;
+        return true;
+    }
+
+    bool Exit(std::uintptr_t token) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(owner != token) {
+            return false;
+        }
+        if(--count == 0) {
+            owner = 0;
+            entry.notify_one();
+        }
+        return true;
+    }
+};
+
+namespace {
+    // Its address identifies the thread, a short has an even address
+    thread_local short threadtoken;
+}
+
+std::uintptr_t ObjectLock::Token() {
+    return reinterpret_cast<std::uintptr_t>(&threadtoken);
+}
+
+ObjectLock::~ObjectLock() {
+    auto w = word.load(std::memory_order_acquire);
+    if(w & Inflated) {
+        delete reinterpret_cast<Monitor*>(w & ~Inflated);
+    }
+}
+
+ObjectLock::Monitor* ObjectLock::Inflate() {
+    auto w = word.load(std::memory_order_acquire);
+    while(!(w & Inflated)) {
+        auto monitor = new Monitor();
+        // The thin owner keeps its lock, its unlock finds the monitor and exits it
+        if(w) {
+            monitor->owner = w;
+            monitor->count = 1;
+        }
+        if(word.compare_exchange_weak(w, reinterpret_cast<std::uintptr_t>(monitor) | Inflated, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return monitor;
+        }
+        // Taken, released or inflated by another thread in between
+        delete monitor;
+    }
+    return reinterpret_cast<Monitor*>(w & ~Inflated);
+}
+
+void ObjectLock::lock() {
+    auto token = Token();
+    std::uintptr_t w = 0;
+    if(word.compare_exchange_strong(w, token, std::memory_order_acquire, std::memory_order_relaxed)) {
+#ifdef EnableJNIVMLockProfiler
+        lockprofiler::Record(LockKind::Object, false, 0);
+#endif
+        return;
+    }
+#ifdef EnableJNIVMLockProfiler
+    auto start = lockprofiler::Now();
+    auto contended = LockSlow(token, w);
+    lockprofiler::Record(LockKind::Object, contended, contended ? lockprofiler::Now() - start : 0);
+#else
+    LockSlow(token, w);
+#endif
+}
+
+bool ObjectLock::LockSlow(std::uintptr_t token, std::uintptr_t w) {
+    auto thin = w && w != token && !(w & Inflated);
+    // Most critical sections are short, wait a little for a thin lock of another thread to be released
+    for(int i = 0; i < SpinCount && w && w != token && !(w & Inflated); ++i) {
+        std::this_thread::yield();
+        w = 0;
+        if(word.compare_exchange_strong(w, token, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return Inflate()->Enter(token) || thin;
+}
+
+bool ObjectLock::try_lock() {
+    auto token = Token();
+    std::uintptr_t w = 0;
+    auto locked = word.compare_exchange_strong(w, token, std::memory_order_acquire, std::memory_order_relaxed) || ((w == token || (w & Inflated)) && Inflate()->TryEnter(token));
+#ifdef EnableJNIVMLockProfiler
+    if(locked) {
+        lockprofiler::Record(LockKind::Object, false, 0);
+    }
+#endif
+    return locked;
+}
+
+bool ObjectLock::unlock() {
+    auto token = Token();
+    auto w = token;
+    if(word.compare_exchange_strong(w, 0, std::memory_order_release, std::memory_order_acquire)) {
+        return true;
+    }
+    return (w & Inflated) && reinterpret_cast<Monitor*>(w & ~Inflated)->Exit(token);
+}
+
+ObjectLock::Monitor* ObjectLock::OwnedMonitor() {
+    auto token = Token();
+    auto w = word.load(std::memory_order_acquire);
+    if(w != token && !(w & Inflated)) {
+        return nullptr;
+    }
+    // Only the owner inflates its thin lock, so the monitor is still owned by this thread
+    auto monitor = Inflate();
+    std::lock_guard<std::mutex> lock(monitor->mtx);
+    return monitor->owner == token ? monitor : nullptr;
+}
+
+bool ObjectLock::Wait(std::int64_t millis) {
+    auto monitor = OwnedMonitor();
+    if(!monitor) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(monitor->mtx);
+    auto token = monitor->owner;
+    auto count = monitor->count;
+    monitor->owner = 0;
+    monitor->count = 0;
+    monitor->entry.notify_one();
+    if(millis > 0) {
+        monitor->waiters.wait_for(lock, std::chrono::milliseconds(millis));
+    } else {
+        monitor->waiters.wait(lock);
+    }
+    monitor->entry.wait(lock, [monitor]() { return !monitor->owner; });
+    monitor->owner = token;
+    monitor->count = count;
+    return true;
+}
+
+bool ObjectLock::Notify() {
+    auto monitor = OwnedMonitor();
+    if(!monitor) {
+        return false;
+    }
+    monitor->waiters.notify_one();
+    return true;
+}
+
+bool ObjectLock::NotifyAll() {
+    auto monitor = OwnedMonitor();
+    if(!monitor) {
+        return false;
+    }
+    monitor->waiters.notify_all();
+    return true;
+}
+
+bool ObjectLock::IsHeldByCurrentThread() const {
+    auto token = Token();
+    auto w = word.load(std::memory_order_acquire);
+    if(!(w & Inflated)) {
+        return w == token;
+    }
+    auto monitor = reinterpret_cast<Monitor*>(w & ~Inflated);
+    std::lock_guard<std::mutex> lock(monitor->mtx);
+    return monitor->owner == token;
+}
@@ -0,0 +1,100 @@
+#include <jnivm/internal/objectPool.h>
+#include <new>
+
+using namespace jnivm;
+
+static_assert(ObjectPool::MaxSize % ObjectPool::Granularity == 0, "MaxSize has to be a multiple of Granularity");
+static_assert(ObjectPool::Granularity % alignof(std::max_align_t) == 0, "Blocks have to be aligned like operator new");
+
+ObjectPool::ObjectPool() : owner(std::this_thread::get_id()) {
+    for(auto&& list : remote) {
+        list.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ObjectPool::~ObjectPool() {
+    // Every allocation holds a reference to its pool, nothing is in use anymore
+    for(auto chunk : chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+void ObjectPool::Trim() {
+    if(chunks.empty() || !IsOwner()) {
+        return;
+    }
+    for(std::size_t i = 0; i + 1 < chunks.size(); ++i) {
+        ::operator delete(chunks[i]);
+    }
+    chunks.erase(chunks.begin(), chunks.end() - 1);
+    for(std::size_t i = 0; i < Classes; ++i) {
+        freelists[i] = nullptr;
+        remote[i].store(nullptr, std::memory_order_relaxed);
+    }
+    // The newest chunk is reused from its start
+    cur = static_cast<char*>(chunks.back());
+    end = cur + ChunkSize;
+}
+
+void* ObjectPool::Refill(std::size_t index) {
+    // Take everything other threads returned at once, only the owner pops so there is no ABA
+    auto block = remote[index].exchange(nullptr, std::memory_order_acquire);
+    if(block) {
+        freelists[index] = block->next;
+        return block;
+    }
+    auto size = (index + 1) * Granularity;
+    if(static_cast<std::size_t>(end - cur) < size) {
+        // The rest of the old chunk is lost, it is smaller than MaxSize
+        cur = static_cast<char*>(::operator new(ChunkSize));
+        end = cur + ChunkSize;
+        chunks.push_back(cur);
+    }
+    auto ret = cur;
+    cur += size;
+    return ret;
+}
+
+void* ObjectPool::Allocate(std::size_t size) {
+    ++allocations;
+    if(size > MaxSize) {
+        ++oversized;
+        return ::operator new(size);
+    }
+    auto index = ClassOf(size);
+    if(auto block = freelists[index]) {
+        freelists[index] = block->next;
+        return block;
+    }
+    return Refill(index);
+}
+
+void ObjectPool::Deallocate(void* p, std::size_t size) {
+    if(size > MaxSize) {
+        if(IsOwner()) {
+            ++deallocations;
+        } else {
+            remotefrees.fetch_add(1, std::memory_order_relaxed);
+        }
+        ::operator delete(p);
+        return;
+    }
+    auto index = ClassOf(size);
+    auto block = static_cast<Block*>(p);
+    if(IsOwner()) {
+        ++deallocations;
+        block->next = freelists[index];
+        freelists[index] = block;
+        return;
+    }
+    remotefrees.fetch_add(1, std::memory_order_relaxed);
+    auto head = remote[index].load(std::memory_order_relaxed);
+    do {
+        block->next = head;
+    } while(!remote[index].compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+ObjectPool::Stats ObjectPool::GetStats() const {
+    auto remote = remotefrees.load(std::memory_order_relaxed);
+    return { allocations, deallocations + remote, remote, oversized, chunks.size() };
+}
@@ -0,0 +1,58 @@
+#include <jnivm/internal/signature.h>
+#include <jnivm/internal/skipJNIType.h>
+
+using namespace jnivm;
+
+MethodSignature::MethodSignature(const std::string& signature) {
+    auto cur = signature.data();
+    auto end = cur + signature.size();
+    if(cur == end || *cur != '(') {
+        return;
+    }
+    ++cur;
+    while(cur != end && *cur != ')') {
+        switch (*cur) {
+        case 'V':
+        case 'Z':
+        case 'B':
+        case 'S':
+        case 'C':
+        case 'I':
+        case 'J':
+        case 'F':
+        case 'D':
+            parameters.push_back(*cur);
+            break;
+        case '[':
+        case 'L':
+            parameters.push_back('L');
+            break;
+        default:
+            return;
+        }
+        cur = SkipJNIType(cur, end);
+        if(cur > end) {
+            return;
+        }
+    }
+    if(cur == end || ++cur == end || parameters.size() > MaxParameters) {
+        return;
+    }
+    switch (*cur) {
+    case 'V':
+    case 'Z':
+    case 'B':
+    case 'S':
+    case 'C':
+    case 'I':
+    case 'J':
+    case 'F':
+    case 'D':
+    case '[':
+    case 'L':
+        returntype = *cur;
+        returnoffset = cur - signature.data();
+        valid = true;
+        break;
+    }
+}
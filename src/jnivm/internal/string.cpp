@@ -11,7 +11,7 @@ jstring jnivm::NewString(JNIEnv *env, const jchar * str, jsize size) {
     for (jsize i = 0; i < size; i++) {
         ss.write(out, JCharToUTF(str[i], out, sizeof(out)));
     }
-    return JNITypes<std::shared_ptr<String>>::ToJNIType(ENV::FromJNIEnv(env), std::make_shared<String>(ss.str()));
+    return JNITypes<std::shared_ptr<String>>::ToJNIType(ENV::FromJNIEnv(env), ENV::FromJNIEnv(env)->MakeShared<String>(ss.str()));
 };
 jsize jnivm::GetStringLength(JNIEnv *env, jstring str) {
     if(str) {
@@ -51,7 +51,7 @@ void jnivm::ReleaseStringChars(JNIEnv * env, jstring str, const jchar * cstr) {
     delete[] cstr;
 };
 jstring jnivm::NewStringUTF(JNIEnv * env, const char *str) {
-    return JNITypes<std::shared_ptr<String>>::ToJNIType(ENV::FromJNIEnv(env), std::make_shared<String>(str ? str : ""));
+    return JNITypes<std::shared_ptr<String>>::ToJNIType(ENV::FromJNIEnv(env), ENV::FromJNIEnv(env)->MakeShared<String>(str ? str : ""));
 };
 jsize jnivm::GetStringUTFLength(JNIEnv *env, jstring str) {
     if(str) {
@@ -17,8 +17,7 @@ jvalue Method::jinvoke(jnivm::ENV &env, jclass cl, jvalue* l) {
 		throw std::runtime_error("jni signature is empty");
 	}
 	jvalue ret;
-	auto type = signature[signature.find_last_of(')') + 1];
-	switch (type) {
+	switch (GetReturnKind()) {
 	case 'V':
 		env.GetJNIEnv()->functions->CallStaticVoidMethodA(env.GetJNIEnv(), cl, (jmethodID)this, l);
 		ret = {};
@@ -62,8 +61,7 @@ jvalue Method::jinvoke(jnivm::ENV &env, jobject obj, jvalue* l) {
 		throw std::runtime_error("jni signature is empty");
 	}
 	jvalue ret;
-	auto type = signature[signature.find_last_of(')') + 1];
-	switch (type) {
+	switch (GetReturnKind()) {
 	case 'V':
 		env.GetJNIEnv()->functions->CallVoidMethodA(env.GetJNIEnv(), obj, (jmethodID)this, l);
 		ret = {};
@@ -2,10 +2,37 @@
 #include <jnivm/object.h>
 #include <jnivm/weak.h>
 
+jnivm::ClassRef::ClassRef(const std::shared_ptr<Class>& clazz) : ref(clazz), pinned(clazz && clazz->pinned.owner ? clazz.get() : nullptr) {
+}
+
+jnivm::ClassRef& jnivm::ClassRef::operator=(const std::shared_ptr<Class>& clazz) {
+    ref = clazz;
+    pinned = clazz && clazz->pinned.owner ? clazz.get() : nullptr;
+    return *this;
+}
+
+jnivm::ClassRef& jnivm::ClassRef::operator=(const std::weak_ptr<Class>& clazz) {
+    return *this = clazz.lock();
+}
+
 std::shared_ptr<jnivm::Class> jnivm::Object::getClassInternal(jnivm::ENV *env) {
     return clazz.lock();
 }
 
+jnivm::Class* jnivm::ClassRef::get(jnivm::ENV *env) const {
+    // Classes are created by make_shared, ref keeps their storage after a destroyed VM released them
+    // Ids are never reused, so the stale owner of such a class doesn't match any living VM
+    return pinned && env && env->GetVM()->GetId() == pinned->pinned.owner ? pinned : nullptr;
+}
+
+jnivm::Class* jnivm::Object::getClassBorrowed(jnivm::ENV *env, std::shared_ptr<Class>& owner) {
+    if(auto cl = clazz.get(env)) {
+        return cl;
+    }
+    owner = getClassInternal(env);
+    return owner.get();
+}
+
 std::vector<std::shared_ptr<jnivm::Class>> jnivm::Object::GetBaseClasses(jnivm::ENV *env) {
 	return { nullptr };
 }
\ No newline at end of file
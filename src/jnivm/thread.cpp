@@ -0,0 +1,67 @@
+#include <jnivm.h>
+#include <jnivm/thread.h>
+#include "internal/log.h"
+#include <chrono>
+#include <stdexcept>
+
+using namespace jnivm;
+
+void Thread::Start(ENV* env) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(state != State::New) {
+            throw std::runtime_error("IllegalThreadStateException: thread already started");
+        }
+        state = State::Running;
+    }
+    auto vm = env->GetVM();
+    std::shared_ptr<Thread> self(shared_from_this(), this);
+    try {
+        vm->StartThread([vm, self]() {
+            auto jvm = vm->GetJavaVM();
+            JNIEnv* jenv = nullptr;
+            jvm->AttachCurrentThread(&jenv, nullptr);
+            auto obj = (jobject)static_cast<Object*>(self.get());
+            // Resolved on the class of the object, so subclasses overriding run are called instead
+            jenv->CallVoidMethod(obj, jenv->GetMethodID(jenv->GetObjectClass(obj), "run", "()V"));
+            if(jenv->ExceptionCheck()) {
+                LOG("JNIVM", "Uncaught exception in thread, the thread terminated");
+                jenv->ExceptionClear();
+            }
+            jvm->DetachCurrentThread();
+            {
+                std::lock_guard<std::mutex> lock(self->mtx);
+                self->state = State::Terminated;
+            }
+            self->finished.notify_all();
+        });
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(mtx);
+        state = State::New;
+        throw;
+    }
+}
+
+void Thread::Run(ENV* env) {
+    if(!target) {
+        return;
+    }
+    auto jenv = env->GetJNIEnv();
+    auto obj = (jobject)static_cast<Object*>(target.get());
+    jenv->CallVoidMethod(obj, jenv->GetMethodID(jenv->GetObjectClass(obj), "run", "()V"));
+}
+
+bool Thread::Join(std::int64_t millis) {
+    std::unique_lock<std::mutex> lock(mtx);
+    auto done = [this]() { return state != State::Running; };
+    if(millis > 0) {
+        return finished.wait_for(lock, std::chrono::milliseconds(millis), done);
+    }
+    finished.wait(lock, done);
+    return true;
+}
+
+bool Thread::IsAlive() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return state == State::Running;
+}
@@ -11,6 +11,7 @@
 #include <climits>
 #include "internal/log.h"
 #include <jnivm/weak.h>
+#include <jnivm/thread.h>
 #include <stdexcept>
 
 using namespace jnivm;
@@ -27,8 +28,7 @@ jclass DefineClass(JNIEnv *, const char *, jobject, const jbyte *, jsize) {
 
 template<bool returnZero=false>
 jclass FindClass(JNIEnv *env, const char *name) {
-	auto&& nenv = *ENV::FromJNIEnv(env);
-	std::lock_guard<std::mutex> lock(nenv.GetVM()->mtx);
+	JNIVM_LOCK_CALLSITE("FindClass");
 	return InternalFindClass(env, name, returnZero, true);
 };
 jmethodID FromReflectedMethod(JNIEnv *env, jobject obj) {
@@ -119,15 +119,7 @@ void FatalError(JNIEnv *, const char * err) {
 jint PushLocalFrame(JNIEnv * env, jint cap) {
 #ifdef EnableJNIVMGC
 	auto&& nenv = *ENV::FromJNIEnv(env);
-	// Add it to the list
-	if(nenv.freeframes.empty()) {
-		nenv.localframe.emplace_front();
-	} else {
-		nenv.localframe.splice_after(nenv.localframe.before_begin(), nenv.freeframes, nenv.freeframes.before_begin());
-	}
-	// Reserve Memory for the new Frame
-	if(cap)
-		nenv.localframe.front().reserve(cap);
+	nenv.localrefs.PushFrame(cap > 0 ? cap : 0);
 #endif
 	return 0;
 };
@@ -136,13 +128,11 @@ jobject PopLocalFrame(JNIEnv * env, jobject result) {
 	auto&& nenv = *ENV::FromJNIEnv(env);
 	// save reference on stack
 	auto res = JNITypes<std::shared_ptr<Object>>::JNICast(&nenv, result);
-	// Clear current Frame and move to freelist
-	nenv.localframe.front().clear();
-	nenv.freeframes.splice_after(nenv.freeframes.before_begin(), nenv.localframe, nenv.localframe.before_begin());
-	if(nenv.localframe.empty()) {
+	// Release all references of the current Frame
+	if(!nenv.localrefs.PopFrame()) {
 		LOG("JNIVM", "Freed top level frame of this ENV, recreate it");
-		nenv.localframe.emplace_front();
 	}
+	nenv.TrimPool();
 	// Add result to previous frame
 	if(res) {
 		return JNITypes<std::shared_ptr<Object>>::ToJNIType(&nenv, res);
@@ -150,37 +140,33 @@ jobject PopLocalFrame(JNIEnv * env, jobject result) {
 #endif
 	return result;
 };
-jobject NewGlobalRef(JNIEnv * env, std::shared_ptr<Object> obj) {
+template<class T> jobject NewGlobalRef(JNIEnv * env, std::shared_ptr<T> obj) {
 #ifdef EnableJNIVMGC
 	if(!obj) return nullptr;
 	auto&& nenv = *ENV::FromJNIEnv(env);
 	auto&& nvm = *nenv.GetVM();
-	std::lock_guard<std::mutex> guard{nvm.mtx};
-	nvm.globals.emplace_back(obj);
+	obj->slot = nvm.globals.Add(obj);
 #endif
-	return (jobject)obj.get();
+	// jobject handles point to the Object base
+	return (jobject)static_cast<Object*>(obj.get());
 };
 jobject NewGlobalRef(JNIEnv * env, jobject obj) {
 	auto strong = JNITypes<std::shared_ptr<Object>>::JNICast(ENV::FromJNIEnv(env), obj);
 	if(!strong) {
 		return (jobject)nullptr;
 	}
-	auto global = std::make_shared<Global>();
+	auto global = ENV::FromJNIEnv(env)->MakeShared<Global>();
 	global->wrapped = std::move(strong);
-	global->clazz = InternalFindClass(ENV::FromJNIEnv(env), "internal/lang/Global");
+	auto&& nvm = *ENV::FromJNIEnv(env)->GetVM();
+	global->clazz = nvm.globalclass ? nvm.globalclass : InternalFindClass(ENV::FromJNIEnv(env), "internal/lang/Global");
 	return NewGlobalRef(env, global);
 };
-void DeleteGlobalRef(JNIEnv * env, std::shared_ptr<Object> obj) {
+template<class T> void DeleteGlobalRef(JNIEnv * env, std::shared_ptr<T> obj) {
 #ifdef EnableJNIVMGC
 	if(!obj) return;
 	auto&& nenv = *ENV::FromJNIEnv(env);
 	auto&& nvm = *nenv.GetVM();
-	std::lock_guard<std::mutex> guard{nvm.mtx};
-	auto fe = nvm.globals.end();
-	auto f = std::find(nvm.globals.begin(), fe, obj);
-	if(f != fe) {
-		nvm.globals.erase(f);
-	} else {
+	if(!nvm.globals.Remove(obj->slot, obj.get())) {
 		LOG("JNIVM", "Failed to delete Global Reference");
 	}
 #endif
@@ -192,15 +178,9 @@ void DeleteLocalRef(JNIEnv * env, std::shared_ptr<Object> obj) {
 #ifdef EnableJNIVMGC
 	if(!obj) return;
 	auto&& nenv = *ENV::FromJNIEnv(env);
-	for(auto && frame : nenv.localframe) {
-		auto fe = frame.end();
-		auto f = std::find(frame.begin(), fe, obj);
-		if(f != fe) {
-			frame.erase(f);
-			return;
-		}
+	if(!nenv.localrefs.Remove(obj.get())) {
+		LOG("JNIVM", "Failed to delete Local Reference");
 	}
-	LOG("JNIVM", "Failed to delete Local Reference");
 #endif
 };
 void DeleteLocalRef(JNIEnv * env, jobject obj) {
@@ -218,8 +198,14 @@ jobject NewLocalRef(JNIEnv * env, std::shared_ptr<Object> obj) {
 #ifdef EnableJNIVMGC
 	if(!obj) return nullptr;
 	auto&& nenv = *ENV::FromJNIEnv(env);
+	auto ref = (jobject)obj.get();
 	// Get the current localframe and create a ref
-	nenv.localframe.front().emplace_back(obj);
+	if(obj->pinned.owner) {
+		nenv.localrefs.AddPinned(obj.get());
+	} else {
+		nenv.localrefs.Add(std::move(obj));
+	}
+	return ref;
 #endif
 	return (jobject)obj.get();
 };
@@ -229,7 +215,7 @@ jobject NewLocalRef(JNIEnv * env, jobject obj) {
 jint EnsureLocalCapacity(JNIEnv * env, jint cap) {
 #ifdef EnableJNIVMGC
 	auto&& nenv = *ENV::FromJNIEnv(env);
-	nenv.localframe.front().reserve(cap);
+	nenv.localrefs.Reserve(cap > 0 ? cap : 0);
 #endif
 	return 0;
 };
@@ -254,11 +240,12 @@ jboolean IsInstanceOf(JNIEnv *env, jobject jo, jclass cl) {
 #include "internal/array.hpp"
 
 jint RegisterNatives(JNIEnv *env, jclass c, const JNINativeMethod *method, jint i) {
+	JNIVM_LOCK_CALLSITE("RegisterNatives");
 	auto&& clazz = JNITypes<std::shared_ptr<jnivm::Class>>::JNICast(ENV::FromJNIEnv(env), c);
 	if(!clazz) {
 		LOG("JNIVM", "RegisterNatives failed, class is nullptr");
 	} else {
-		std::lock_guard<std::mutex> lock(clazz->mtx);
+		std::lock_guard<ClassMutex> lock(clazz->mtx);
 		while(i--) {
 			clazz->natives[method->name] = method->fnPtr;
 #ifdef JNI_TRACE
@@ -266,45 +253,80 @@ jint RegisterNatives(JNIEnv *env, jclass c, const JNINativeMethod *method, jint
 			ss << "Class \"" << clazz->nativeprefix << "\" registred native method: " << method->name << " signature: " << method->signature;
 			LOG("JNIVM", "%s", ss.str().data());
 #endif
-			auto m = std::make_shared<Method>();
-			m->name = method->name;
-			m->signature = method->signature;
-			m->native = method->fnPtr;
-			clazz->methods.push_back(m);
+			if(auto m = clazz->FindMethod(method->name, method->signature, MemberKind::Native)) {
+				m->native = method->fnPtr;
+			} else {
+				clazz->AddMethod(std::make_shared<Method>(method->name, method->signature, false, method->fnPtr));
+			}
 			method++;
 		}
+		Class::InvalidateVTables(ENV::FromJNIEnv(env));
 	}
 	return 0;
 };
 jint UnregisterNatives(JNIEnv *env, jclass c) {
+	JNIVM_LOCK_CALLSITE("UnregisterNatives");
 	auto&& clazz = JNITypes<std::shared_ptr<jnivm::Class>>::JNICast(ENV::FromJNIEnv(env), c);
 	if(!clazz) {
 		LOG("JNIVM", "UnRegisterNatives failed, class is nullptr");
 	} else {
-		std::lock_guard<std::mutex> lock(clazz->mtx);
+		std::lock_guard<ClassMutex> lock(clazz->mtx);
 		clazz->natives.clear();
 		for(size_t i = 0; i < clazz->methods.size(); ++i) {
 			if(clazz->methods[i]->native) {
+				clazz->methodindex.Erase(clazz->methods[i].get());
 				clazz->methods.erase(clazz->methods.begin() + i);
 				--i;
 			}
 		}
+		Class::InvalidateVTables(ENV::FromJNIEnv(env));
 	}
 	return 0;
 };
 
+static void RequireMonitor(bool owner) {
+	if(!owner) {
+		throw std::runtime_error("IllegalMonitorStateException: current thread is not owner");
+	}
+}
+
+static void RequireTimeout(jlong millis) {
+	if(millis < 0) {
+		throw std::invalid_argument("IllegalArgumentException: timeout value is negative");
+	}
+}
+
+// The caller keeps o alive, only the target of a weak reference has to be locked
+static Object* MonitorTarget(JNIEnv *env, jobject o, std::shared_ptr<Object>& keep) {
+	auto obj = (Object*)o;
+	if(obj && obj->kind == ObjectKind::Global) {
+		return jnivm::impl::CachedCast<Global>::Cast(obj)->wrapped.get();
+	}
+	if(obj && obj->kind == ObjectKind::Weak) {
+		keep = JNITypes<std::shared_ptr<Object>>::JNICast(ENV::FromJNIEnv(env), o);
+		return keep.get();
+	}
+	return obj;
+}
+
 jint MonitorEnter(JNIEnv *env, jobject o) {
-	JNITypes<std::shared_ptr<jnivm::Object>>::JNICast(ENV::FromJNIEnv(env), o)->lock.lock.lock();
+	JNIVM_LOCK_CALLSITE("MonitorEnter");
+	std::shared_ptr<Object> keep;
+	auto obj = MonitorTarget(env, o, keep);
+	if(!obj) {
+		return JNI_ERR;
+	}
+	obj->lock.lock();
 	return 0;
 };
 jint MonitorExit(JNIEnv *env, jobject o) {
-	JNITypes<std::shared_ptr<jnivm::Object>>::JNICast(ENV::FromJNIEnv(env), o)->lock.lock.unlock();
-	return 0;
+	std::shared_ptr<Object> keep;
+	auto obj = MonitorTarget(env, o, keep);
+	return obj && obj->lock.unlock() ? 0 : JNI_ERR;
 }
 
 jint GetJavaVM(JNIEnv * env, JavaVM ** vm) {
 	if(vm) {
-		std::lock_guard<std::mutex> lock((ENV::FromJNIEnv(env))->GetVM()->mtx);
 		*vm = (ENV::FromJNIEnv(env))->GetVM()->GetJavaVM();
 	}
 	return 0;
@@ -315,11 +337,15 @@ jweak NewWeakGlobalRef(JNIEnv *env, jobject obj) {
 	if(!strong) {
 		return (jweak)nullptr;
 	}
-	auto weak = std::make_shared<Weak>();
+	auto weak = ENV::FromJNIEnv(env)->MakeShared<Weak>();
 	weak->wrapped = strong;
-	weak->clazz = InternalFindClass(ENV::FromJNIEnv(env), "java/lang/ref/WeakReference");
-
-	return (jweak) NewGlobalRef(env, weak);
+	auto&& nvm = *ENV::FromJNIEnv(env)->GetVM();
+	weak->clazz = nvm.weakclass ? nvm.weakclass : InternalFindClass(ENV::FromJNIEnv(env), "java/lang/ref/WeakReference");
+#ifdef EnableJNIVMGC
+	weak->slot = nvm.globals.AddWeak(weak);
+#endif
+	// jobject handles point to the Object base
+	return (jweak)static_cast<Object*>(weak.get());
 }
 void DeleteWeakGlobalRef(JNIEnv *env, jweak w) {
 	DeleteGlobalRef(env, JNITypes<std::shared_ptr<Weak>>::JNICast(ENV::FromJNIEnv(env), w));
@@ -334,13 +360,14 @@ jobjectRefType GetObjectRefType(JNIEnv *env, jobject obj) {
 	if(!obj) {
 		return jobjectRefType::JNIInvalidRefType;
 	}
-	auto o = reinterpret_cast<Object*>(obj);
-	if(dynamic_cast<Weak*>(o)) {
+	switch(reinterpret_cast<Object*>(obj)->kind) {
+	case ObjectKind::Weak:
 		return jobjectRefType::JNIWeakGlobalRefType;
-	} else if(dynamic_cast<Global*>(o)){
+	case ObjectKind::Global:
 		return jobjectRefType::JNIGlobalRefType;
+	default:
+		return jobjectRefType::JNILocalRefType;
 	}
-	return jobjectRefType::JNILocalRefType;
 };
 
 template<class ...jnitypes> struct JNINativeInterfaceCompose;
@@ -466,33 +493,46 @@ jnivm::VM::VM(bool skipInit, bool ReturnNull) : ninterface(ReturnNull ? GetNativ
 				return JNI_OK;
 			},
 			[](JavaVM *vm, JNIEnv **penv, void * args) -> jint {
+				JNIVM_LOCK_CALLSITE("AttachCurrentThread");
 #ifdef EnableJNIVMGC
 				auto&& nvm = *VM::FromJavaVM(vm);
-				std::lock_guard<std::mutex> lock(nvm.mtx);
-				auto&& nenv = nvm.jnienvs[pthread_self()];
+				// Already attached threads don't take the lock
+				auto&& nenv = nvm.CurrentEnv();
 				if(!nenv) {
-					nenv = nvm.CreateEnv();
+					auto env = nvm.AttachEnv();
+					std::lock_guard<EnvMutex> lock(nvm.envmtx);
+					nenv = std::move(env);
 				}
 				if(penv) {
 					*penv = nenv->GetJNIEnv();
 				}
 #else
 				if(penv) {
-					std::lock_guard<std::mutex> lock((VM::FromJavaVM(vm)))->mtx);
-					*penv = (VM::FromJavaVM(vm)))->GetJNIEnv();
+					*penv = VM::FromJavaVM(vm)->GetJNIEnv();
 				}
 #endif
 				return JNI_OK;
 			},
 			[](JavaVM *vm) -> jint {
+				JNIVM_LOCK_CALLSITE("DetachCurrentThread");
 #ifdef EnableJNIVMGC
 				auto&& nvm = *VM::FromJavaVM(vm);
-				std::lock_guard<std::mutex> lock(nvm.mtx);
-				auto fe = nvm.jnienvs.end();
-				auto f = nvm.jnienvs.find(pthread_self());
-				if(f != fe) {
-					nvm.jnienvs.erase(f);
+				std::shared_ptr<ENV> env;
+				{
+					std::lock_guard<EnvMutex> lock(nvm.envmtx);
+					auto fe = nvm.jnienvs.end();
+					auto f = nvm.jnienvs.find(pthread_self());
+					if(f != fe) {
+						env = std::move(f->second);
+						nvm.jnienvs.erase(f);
+					}
+					nvm.ForgetEnv();
 				}
+				if(env) {
+					nvm.DetachEnv(std::move(env));
+				}
+				// Weak references of short lived threads are swept, even if no thread creates new ones
+				nvm.globals.Sweep(VM::SweepPerDetach);
 #endif
 				return JNI_OK;
 			},
@@ -501,8 +541,8 @@ jnivm::VM::VM(bool skipInit, bool ReturnNull) : ninterface(ReturnNull ? GetNativ
 #ifdef EnableJNIVMGC
 					return vm->AttachCurrentThread((JNIEnv**)penv, nullptr);
 #else
-					std::lock_guard<std::mutex> lock((VM::FromJavaVM(vm)))->mtx);
-					*penv = (VM::FromJavaVM(vm)))->GetJNIEnv();
+					// The only ENV is created by initialize and never replaced
+					*penv = VM::FromJavaVM(vm)->GetJNIEnv();
 #endif
 				}
 				return JNI_OK;
@@ -516,23 +556,164 @@ jnivm::VM::VM(bool skipInit, bool ReturnNull) : ninterface(ReturnNull ? GetNativ
 	np.name = "jnivm";
 #endif
 	javaVM.functions = &iinterface;
+#ifdef EnableJNIVMGC
+	globals.onpeak = [this](std::size_t count) {
+		auto threshold = globalthreshold.load(std::memory_order_relaxed);
+		if(!threshold || count < threshold) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(monitormtx);
+			if(count < nextglobalreport) {
+				return;
+			}
+			nextglobalreport = count * 2;
+		}
+		ReportReferences(nullptr, ReferenceKind::Global, count);
+	};
+#endif
 	if(skipInit == false)
 		initialize();
 }
 
 jnivm::VM::VM() : VM(false) {};
 
+void jnivm::VM::Pin(const std::shared_ptr<Object>& obj) {
+	if(!obj || obj->pinned.owner) {
+		return;
+	}
+	std::lock_guard<PinnedMutex> lock(pinnedmtx);
+	pinned.emplace_back(obj);
+	obj->pinned.owner = id;
+}
+
+void jnivm::VM::SetReferenceMonitor(ReferenceMonitor monitor) {
+	std::lock_guard<std::mutex> lock(monitormtx);
+	localthreshold.store(monitor.locals, std::memory_order_relaxed);
+	globalthreshold.store(monitor.globals, std::memory_order_relaxed);
+	nextglobalreport = 0;
+	this->monitor = std::move(monitor);
+}
+
+void jnivm::VM::ReportReferences(ENV* env, ReferenceKind kind, std::size_t count) {
+	std::function<void(ENV*, ReferenceKind, std::size_t)> callback;
+	{
+		std::lock_guard<std::mutex> lock(monitormtx);
+		callback = monitor.callback;
+	}
+	if(callback) {
+		callback(env, kind, count);
+	} else {
+		LOG("JNIVM", "%s references exceeded the threshold, %zu references in use", kind == ReferenceKind::Local ? "Local" : "Global", count);
+	}
+}
+
+Executor& jnivm::VM::GetExecutor() {
+	std::lock_guard<std::mutex> lock(executormtx);
+	if(!executor) {
+		auto threads = executorthreads.load(std::memory_order_relaxed);
+		executor.reset(new Executor(this, threads ? threads : std::thread::hardware_concurrency()));
+	}
+	return *executor;
+}
+
+void jnivm::VM::StopExecutor() {
+	std::unique_ptr<Executor> stopped;
+	{
+		std::lock_guard<std::mutex> lock(executormtx);
+		stopped = std::move(executor);
+	}
+}
+
+void jnivm::VM::StartThread(std::function<void()> f) {
+	threads.Start(std::move(f));
+}
+
+std::size_t jnivm::VM::CollectWeak() {
+#ifdef EnableJNIVMGC
+	return globals.Collect();
+#else
+	return 0;
+#endif
+}
+
+std::vector<LockProfile> jnivm::VM::GetLockProfile() {
+	return lockprofiler::Collect();
+}
+
+std::string jnivm::VM::GetLockReport() {
+	return lockprofiler::Format(lockprofiler::Collect());
+}
+
+void jnivm::VM::ResetLockProfile() {
+	lockprofiler::Reset();
+}
+
 void VM::initialize() {
 	auto env = jnienvs[pthread_self()] = CreateEnv();
-	env->GetClass<Object>("java/lang/Object");
+	auto object = env->GetClass<Object>("java/lang/Object");
+	object->HookInstanceFunction(env.get(), "wait", [](Object* self) {
+		RequireMonitor(self->lock.Wait());
+	});
+	object->HookInstanceFunction(env.get(), "wait", [](Object* self, jlong millis) {
+		RequireTimeout(millis);
+		RequireMonitor(self->lock.Wait(millis));
+	});
+	object->HookInstanceFunction(env.get(), "wait", [](Object* self, jlong millis, jint nanos) {
+		RequireTimeout(millis);
+		if(nanos < 0 || nanos > 999999) {
+			throw std::invalid_argument("IllegalArgumentException: nanosecond timeout value out of range");
+		}
+		// Rounded up to the next millisecond like Java
+		RequireMonitor(self->lock.Wait(millis + (nanos > 0)));
+	});
+	object->HookInstanceFunction(env.get(), "notify", [](Object* self) {
+		RequireMonitor(self->lock.Notify());
+	});
+	object->HookInstanceFunction(env.get(), "notifyAll", [](Object* self) {
+		RequireMonitor(self->lock.NotifyAll());
+	});
+	env->GetClass<Runnable>("java/lang/Runnable");
+	auto thread = env->GetClass<Thread>("java/lang/Thread");
+	thread->Hook(env.get(), "<init>", []() {
+		return std::make_shared<Thread>();
+	});
+	// Implementations of Runnable don't have to derive from jnivm::Runnable, so the target is hooked as Object
+	thread->Hook(env.get(), "<init>", "(Ljava/lang/Runnable;)Ljava/lang/Thread;", [](std::shared_ptr<Object> target) {
+		auto thread = std::make_shared<Thread>();
+		thread->target = std::move(target);
+		return thread;
+	});
+	thread->HookInstanceFunction(env.get(), "start", [](ENV* env, Thread* self) {
+		self->Start(env);
+	});
+	thread->HookInstanceFunction(env.get(), "run", [](ENV* env, Thread* self) {
+		self->Run(env);
+	});
+	thread->HookInstanceFunction(env.get(), "join", [](Thread* self) {
+		self->Join();
+	});
+	thread->HookInstanceFunction(env.get(), "join", [](Thread* self, jlong millis) {
+		RequireTimeout(millis);
+		self->Join(millis);
+	});
+	thread->HookInstanceFunction(env.get(), "isAlive", [](Thread* self) {
+		return (jboolean)self->IsAlive();
+	});
 	env->GetClass<Class>("java/lang/Class");
 	env->GetClass<String>("java/lang/String");
 	env->GetClass<ByteBuffer>("java/nio/ByteBuffer");
 	env->GetClass<Throwable>("java/lang/Throwable");
 	env->GetClass<Method>("java/lang/reflect/Method");
 	env->GetClass<Field>("java/lang/reflect/Field");
-	env->GetClass<Weak>("java/lang/ref/WeakReference");
-	env->GetClass<Global>("internal/lang/Global");
+	weakclass = env->GetClass<Weak>("java/lang/ref/WeakReference");
+	globalclass = env->GetClass<Global>("internal/lang/Global");
+}
+
+std::shared_ptr<Class> VM::FindType(const std::type_index& type) {
+	std::shared_lock<TypeCheckMutex> lock(typecheckmtx);
+	auto f = typecheck.find(type);
+	return f != typecheck.end() ? f->second : nullptr;
 }
 
 JavaVM *VM::GetJavaVM() {
@@ -543,14 +724,46 @@ JNIEnv *VM::GetJNIEnv() {
 	return GetEnv()->GetJNIEnv();
 }
 
-const std::shared_ptr<ENV>& VM::GetEnv() {
+namespace {
+	// Map entry of the last VM used by this thread, entries of unordered_map are never moved
+	struct EnvCache {
+		std::uint64_t vm = 0;
+		std::shared_ptr<ENV>* env = nullptr;
+	};
+	thread_local EnvCache envcache;
+	std::atomic<std::uint64_t> nextvmid { 1 };
+}
+
+std::uint64_t jnivm::VM::NextId() {
+	return nextvmid.fetch_add(1, std::memory_order_relaxed);
+}
+
+void jnivm::VM::ForgetEnv() {
+	if(envcache.vm == id) {
+		envcache = {};
+	}
+}
+
+std::shared_ptr<ENV>& jnivm::VM::CurrentEnv() {
 #ifdef EnableJNIVMGC
-	return jnienvs[pthread_self()];
+	auto&& cache = envcache;
+	if(cache.vm == id) {
+		return *cache.env;
+	}
+	std::lock_guard<EnvMutex> lock(envmtx);
+	// Creates an empty entry for threads not attached yet, AttachCurrentThread fills the same entry
+	auto&& env = jnienvs[pthread_self()];
+	cache = { id, &env };
+	return env;
 #else
 	return jnienvs.begin()->second;
 #endif
 }
 
+const std::shared_ptr<ENV>& VM::GetEnv() {
+	return CurrentEnv();
+}
+
 void jnivm::VM::OverrideJNIInvokeInterface(const JNIInvokeInterface &iinterface) {
 	if(iinterface.reserved0 != nullptr && iinterface.reserved0 != this->iinterface.reserved0) {
 		throw std::runtime_error("Updating `iinterface.reserved0` to a different value is forbidden");
@@ -561,11 +774,82 @@ void jnivm::VM::OverrideJNIInvokeInterface(const JNIInvokeInterface &iinterface)
 }
 
 std::shared_ptr<jnivm::ENV> jnivm::VM::CreateEnv() {
-	auto tmpl = GetNativeInterfaceTemplate();
+	std::lock_guard<HookMutex> lock(hookmtx);
+	UpdateHookedInterface();
+	auto env = std::make_shared<ENV>(this, hookedinterface);
+	env->reusable = true;
+	env->interfaceversion = interfaceversion;
+	return env;
+}
+
+void jnivm::VM::AddHook(std::function<void(JNINativeInterface&)>&& hook) {
+	std::lock_guard<HookMutex> lock(hookmtx);
+	jnienvhooks.emplace_back(std::move(hook));
+	hookedcount = SIZE_MAX;
+}
+
+void jnivm::VM::UpdateHookedInterface() {
+	// Derived VMs may also append to jnienvhooks directly
+	if(hookedcount == jnienvhooks.size()) {
+		return;
+	}
+	hookedinterface = GetNativeInterfaceTemplate();
 	for(auto && hook : jnienvhooks) {
-        hook(tmpl);
-    }
-	return std::make_shared<ENV>(this, tmpl);
+		hook(hookedinterface);
+	}
+	hookedcount = jnienvhooks.size();
+	++interfaceversion;
+}
+
+JNINativeInterface jnivm::VM::GetHookedInterface() {
+	std::lock_guard<HookMutex> lock(hookmtx);
+	UpdateHookedInterface();
+	return hookedinterface;
+}
+
+std::shared_ptr<jnivm::ENV> jnivm::VM::AttachEnv() {
+	std::shared_ptr<ENV> env;
+	{
+		std::lock_guard<EnvMutex> lock(envmtx);
+		if(!envpool.empty()) {
+			env = std::move(envpool.back());
+			envpool.pop_back();
+		}
+	}
+	if(!env) {
+		return CreateEnv();
+	}
+#ifdef EnableJNIVMPool
+	// Allocations of the previous thread may still be alive, they keep using its old pool
+	// An ENV whose pool was reset keeps pooling disabled
+	if(env->pool) {
+		if(env->pool.use_count() == 1) {
+			env->pool->Rebind();
+		} else {
+			env->pool = std::make_shared<ObjectPool>();
+		}
+	}
+#endif
+	std::lock_guard<HookMutex> lock(hookmtx);
+	UpdateHookedInterface();
+	if(env->interfaceversion != interfaceversion) {
+		env->OverrideJNINativeInterface(hookedinterface);
+		env->interfaceversion = interfaceversion;
+	}
+	return env;
+}
+
+void jnivm::VM::DetachEnv(std::shared_ptr<ENV> env) {
+	// ENVs of derived VMs may be bound to their thread, ENVs still referenced elsewhere are still in use
+	if(!env->reusable || env.use_count() != 1 || envpoolsize.load(std::memory_order_relaxed) == 0) {
+		return;
+	}
+	// Released on the detaching thread, outside of envmtx
+	env->Reset();
+	std::lock_guard<EnvMutex> lock(envmtx);
+	if(envpool.size() < envpoolsize.load(std::memory_order_relaxed)) {
+		envpool.emplace_back(std::move(env));
+	}
 }
 
 const JNINativeInterface &jnivm::VM::GetNativeInterfaceTemplate() {
@@ -184,6 +184,50 @@ TEST(JNIVM, jValuesfromValistPrimitives) {
     ASSERT_EQ(v1[7].l, (jstring) 0x24455464);
 }
 
+void jValuesfromValistParsedTestHelper(jvalue* values, const jnivm::MethodSignature* sign, ...) {
+    va_list l;
+    va_start(l, sign);
+    jnivm::JValuesfromValist(l, *sign, values);
+    va_end(l);
+}
+
+TEST(JNIVM, jValuesfromValistParsedSignature) {
+    jnivm::MethodSignature sign("(ZIJ[[Ljava/lang/String;DFLjava/lang/String;C)V");
+    ASSERT_TRUE(sign.valid);
+    ASSERT_EQ(sign.parameters, "ZIJLDFLC");
+    jvalue v1[8];
+    jValuesfromValistParsedTestHelper(v1, &sign, 1, std::numeric_limits<jint>::max(), std::numeric_limits<jlong>::max() / 2, (jobject) 0x1234, 2.5, 1.5f, (jstring) 0x24455464, 'c');
+    ASSERT_EQ(v1[0].z, 1);
+    ASSERT_EQ(v1[1].i, std::numeric_limits<jint>::max());
+    ASSERT_EQ(v1[2].j, std::numeric_limits<jlong>::max() / 2);
+    ASSERT_EQ(v1[3].l, (jobject) 0x1234);
+    ASSERT_EQ(v1[4].d, 2.5);
+    ASSERT_EQ(v1[5].f, 1.5f);
+    ASSERT_EQ(v1[6].l, (jstring) 0x24455464);
+    ASSERT_EQ(v1[7].c, 'c');
+    ASSERT_FALSE(jnivm::MethodSignature("").valid);
+    ASSERT_FALSE(jnivm::MethodSignature("I").valid);
+    ASSERT_FALSE(jnivm::MethodSignature("(Ljava/lang/String").valid);
+    ASSERT_FALSE(jnivm::MethodSignature("(I").valid);
+    ASSERT_TRUE(jnivm::MethodSignature("()V").valid);
+    ASSERT_FALSE(jnivm::MethodSignature("()").valid);
+}
+
+TEST(JNIVM, MethodReturnType) {
+    jnivm::Method m("test", "(IJ)[Ljava/lang/String;");
+    ASSERT_EQ(m.parsedsignature.parameters.size(), 2);
+    ASSERT_EQ(m.GetReturnKind(), '[');
+    ASSERT_STREQ(m.GetReturnType(), "[Ljava/lang/String;");
+    jnivm::Method m2;
+    m2.signature = "(Ljava/lang/Object;)I";
+    ASSERT_FALSE(m2.parsedsignature.valid);
+    ASSERT_EQ(m2.GetReturnKind(), 'I');
+    ASSERT_STREQ(m2.GetReturnType(), "I");
+    jnivm::Method m3("test", "(I");
+    ASSERT_EQ(m3.GetReturnKind(), 0);
+    ASSERT_EQ(m3.GetReturnType(), nullptr);
+}
+
 #include <jnivm/internal/skipJNIType.h>
 
 TEST(JNIVM, skipJNITypeTest) {
@@ -898,6 +942,41 @@ TEST(JNIVM, VirtualFunction) {
     ASSERT_EQ(env->GetJNIEnv()->CallNonvirtualIntMethod(ptr, _c, env->GetJNIEnv()->GetMethodID(_c2, "Test2", "()I")), (int)TestEnum::A);
 }
 
+TEST(JNIVM, VirtualFunctionHierarchy) {
+    jnivm::VM vm;
+    class TestClass : public jnivm::Extends<> {};
+    class TestClass2 : public jnivm::Extends<TestClass> {};
+    class TestClass3 : public jnivm::Extends<TestClass2> {};
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass<TestClass>("TestClass");
+    auto c2 = env->GetClass<TestClass2>("TestClass2");
+    auto c3 = env->GetClass<TestClass3>("TestClass3");
+    c->HookInstanceFunction(env, "Test", [](TestClass*) {
+        return 1;
+    });
+    c2->HookInstanceFunction(env, "Test", [](TestClass2*) {
+        return 2;
+    });
+    auto val = std::make_shared<TestClass3>();
+    auto ptr = jnivm::JNITypes<decltype(val)>::ToJNIReturnType(env, val);
+    auto _c = jnivm::JNITypes<decltype(c)>::ToJNIType(env, c);
+    auto id = env->GetJNIEnv()->GetMethodID(_c, "Test", "()I");
+    // Resolves the override of the nearest base class
+    ASSERT_EQ(env->GetJNIEnv()->CallIntMethod(ptr, id), 2);
+    ASSERT_EQ(env->GetJNIEnv()->CallIntMethod(ptr, id), 2);
+    {
+        std::lock_guard<jnivm::ClassMutex> lock(c3->mtx);
+        ASSERT_EQ(c3->vtable.size(), 1);
+    }
+    // Hooking a more derived override invalidates the cached entry
+    c3->HookInstanceFunction(env, "Test", [](TestClass3*) {
+        return 3;
+    });
+    ASSERT_EQ(env->GetJNIEnv()->CallIntMethod(ptr, id), 3);
+    auto val2 = std::make_shared<TestClass2>();
+    ASSERT_EQ(env->GetJNIEnv()->CallIntMethod(jnivm::JNITypes<decltype(val2)>::ToJNIReturnType(env, val2), id), 2);
+}
+
 }
 #include <thread>
 TEST(JNIVM, VM) {
@@ -1518,4 +1597,1149 @@ TEST(JNIVM, OptionalParameter) {
     auto m = env->GetJNIEnv()->GetStaticMethodID(c, "member6", "()V");
     ASSERT_TRUE(m);
     env->GetJNIEnv()->CallStaticVoidMethod(c, m);
-}
\ No newline at end of file
+}
+
+TEST(JNIVM, MemberIndex) {
+    using namespace jnivm;
+    VM vm;
+    auto&& env = vm.GetEnv();
+    auto cl = env->GetClass("IndexTest");
+    cl->HookInstanceFunction(env.get(), "member", [](Object* obj, jint i) {});
+    cl->Hook(env.get(), "member", [](jint i) {});
+    cl->HookInstanceFunction(env.get(), "member", [](Object* obj, jlong i) {});
+    auto jenv = env->GetJNIEnv();
+    auto c = jenv->FindClass("IndexTest");
+    auto m1 = jenv->GetMethodID(c, "member", "(I)V");
+    auto m2 = jenv->GetStaticMethodID(c, "member", "(I)V");
+    auto m3 = jenv->GetMethodID(c, "member", "(J)V");
+    ASSERT_TRUE(m1);
+    ASSERT_TRUE(m2);
+    ASSERT_TRUE(m3);
+    ASSERT_NE(m1, m2);
+    ASSERT_NE(m1, m3);
+    ASSERT_EQ(m1, jenv->GetMethodID(c, "member", "(I)V"));
+    ASSERT_EQ(m2, jenv->GetStaticMethodID(c, "member", "(I)V"));
+    {
+        std::lock_guard<jnivm::ClassMutex> lock(cl->mtx);
+        ASSERT_EQ((jmethodID)cl->FindMethod("member", "(I)V", MemberKind::Instance), m1);
+        ASSERT_EQ((jmethodID)cl->FindMethod("member", "(I)V", MemberKind::Static), m2);
+        ASSERT_EQ(cl->FindMethod("member", "(I)V", MemberKind::Native), nullptr);
+        ASSERT_EQ(cl->methodindex.Size(), cl->methods.size());
+    }
+    // Unresolved symbols are added to the index once
+    auto u = jenv->GetMethodID(c, "unknown", "()V");
+    ASSERT_EQ(u, jenv->GetMethodID(c, "unknown", "()V"));
+    auto f = jenv->GetFieldID(c, "unknownfield", "I");
+    ASSERT_EQ(f, jenv->GetFieldID(c, "unknownfield", "I"));
+    ASSERT_NE((jfieldID)f, jenv->GetStaticFieldID(c, "unknownfield", "I"));
+
+    JNINativeMethod natives[] = {
+        { "native", "()V", (void*)+[](JNIEnv*, jobject) {} },
+    };
+    jenv->RegisterNatives(c, natives, 1);
+    jenv->RegisterNatives(c, natives, 1);
+    {
+        std::lock_guard<jnivm::ClassMutex> lock(cl->mtx);
+        ASSERT_NE(cl->FindMethod("native", "()V", MemberKind::Native), nullptr);
+        ASSERT_EQ(cl->methodindex.Size(), cl->methods.size());
+    }
+    jenv->UnregisterNatives(c);
+    {
+        std::lock_guard<jnivm::ClassMutex> lock(cl->mtx);
+        ASSERT_EQ(cl->FindMethod("native", "()V", MemberKind::Native), nullptr);
+        ASSERT_EQ(cl->methodindex.Size(), cl->methods.size());
+        ASSERT_EQ(cl->fieldindex.Size(), cl->fields.size());
+    }
+}
+
+TEST(JNIVM, StubCounter) {
+    jnivm::VM vm;
+    auto env = vm.GetJNIEnv();
+    auto c = env->FindClass("StubTest");
+    auto m = env->GetStaticMethodID(c, "unknown", "()LStubDummy;");
+    auto m2 = env->GetStaticMethodID(c, "unknown2", "()[I");
+    auto m3 = env->GetStaticMethodID(c, "unknown3", "()I");
+    auto f = env->GetStaticFieldID(c, "unknown", "I");
+    auto obj = env->CallStaticObjectMethod(c, m);
+    auto obj2 = env->CallStaticObjectMethod(c, m);
+    auto arr = (jintArray)env->CallStaticObjectMethod(c, m2);
+    ASSERT_EQ(env->CallStaticIntMethod(c, m3), 0);
+    ASSERT_EQ(env->GetStaticIntField(c, f), 0);
+    env->SetStaticIntField(c, f, 1);
+#ifdef JNI_RETURN_NON_ZERO
+    // The dummy object is created once and shared by every call
+    ASSERT_NE(obj, nullptr);
+    ASSERT_TRUE(env->IsSameObject(obj, obj2));
+    ASSERT_TRUE(env->IsInstanceOf(obj, env->FindClass("StubDummy")));
+    ASSERT_NE(arr, nullptr);
+    ASSERT_EQ(env->GetArrayLength(arr), 0);
+#else
+    ASSERT_EQ(obj, nullptr);
+    ASSERT_EQ(obj2, nullptr);
+    ASSERT_EQ(arr, nullptr);
+#endif
+    ASSERT_EQ(((jnivm::Method*)m)->stub.calls, 2);
+    ASSERT_EQ(((jnivm::Method*)m2)->stub.calls, 1);
+    ASSERT_EQ(((jnivm::Method*)m3)->stub.calls, 1);
+    ASSERT_EQ(((jnivm::Field*)f)->stub.calls, 2);
+}
+
+TEST(JNIVM, StubReturningOwnClass) {
+    std::weak_ptr<jnivm::Class> weak;
+    {
+        jnivm::VM vm;
+        auto env = vm.GetJNIEnv();
+        auto c = env->FindClass("StubCycle");
+        env->CallStaticObjectMethod(c, env->GetStaticMethodID(c, "self", "()LStubCycle;"));
+        weak = vm.classes.at("StubCycle");
+    }
+    // The cached return value of the stub doesn't keep the class owning it alive
+    ASSERT_TRUE(weak.expired());
+}
+
+TEST(JNIVM, TypedNativeInvoke) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto c = env->GetClass("NativeInvokeTest");
+    JNINativeMethod natives[] = {
+        { "add", "(IJ)J", (void*)+[](JNIEnv*, jclass, jint a, jlong b) -> jlong { return a + b; } },
+        { "self", "(Ljava/lang/Object;)Ljava/lang/Object;", (void*)+[](JNIEnv*, jobject, jobject o) -> jobject { return o; } },
+        { "fail", "()V", (void*)+[](JNIEnv* env, jclass) { env->ThrowNew(env->FindClass("java/lang/Throwable"), "fail"); } },
+    };
+    env->GetJNIEnv()->RegisterNatives((jclass)c.get(), natives, sizeof(natives) / sizeof(*natives));
+    jnivm::Method *add, *self, *fail;
+    {
+        std::lock_guard<jnivm::ClassMutex> lock(c->mtx);
+        add = c->FindMethod("add", "(IJ)J", jnivm::MemberKind::Native);
+        self = c->FindMethod("self", "(Ljava/lang/Object;)Ljava/lang/Object;", jnivm::MemberKind::Native);
+        fail = c->FindMethod("fail", "()V", jnivm::MemberKind::Native);
+    }
+    ASSERT_TRUE(add && self && fail);
+    auto jenv = env->GetJNIEnv();
+    ASSERT_EQ(add->invokeAs<jlong>(*jenv, c.get(), (jint)2, (jlong)40), 42);
+    ASSERT_EQ(add->invoke(*jenv, c.get(), (jint)2, (jlong)40).j, 42);
+    ASSERT_THROW(add->invokeAs<jint>(*jenv, c.get(), (jint)2, (jlong)40), std::runtime_error);
+    ASSERT_THROW(add->invokeAs<jlong>(*jenv, c.get(), (jint)2), std::runtime_error);
+    ASSERT_THROW(add->invokeAs<jlong>(*jenv, c.get(), (jint)2, (jint)40), std::runtime_error);
+    auto obj = std::make_shared<jnivm::Object>();
+    ASSERT_EQ(self->invokeAs<jobject>(*jenv, obj.get(), (jobject)obj.get()), (jobject)obj.get());
+    ASSERT_ANY_THROW(fail->invokeAs<void>(*jenv, c.get()));
+    jenv->ExceptionClear();
+}
+
+TEST(JNIVM, MethodHandleMismatch) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto c = env->GetClass<Class1>("Class1");
+    c->Hook(env.get(), "Test", [](jint a) {
+        return a + 1;
+    });
+    c->Hook(env.get(), "b", &Class1::b);
+    auto jenv = env->GetJNIEnv();
+    auto handle = c->FindMethod("Test", "(I)I", jnivm::MemberKind::Static)->nativehandle;
+    jvalue value;
+    value.i = 1;
+    ASSERT_EQ(handle->StaticInvoke<jint>(env.get(), c.get(), &value), 2);
+    ASSERT_THROW(handle->StaticInvoke<jlong>(env.get(), c.get(), &value), std::runtime_error);
+    ASSERT_THROW(handle->InstanceInvoke<jint>(env.get(), nullptr, &value), std::runtime_error);
+    auto id = jenv->GetStaticMethodID((jclass)c.get(), "Test", "(I)I");
+    ASSERT_EQ(jenv->CallStaticIntMethod((jclass)c.get(), id, 1), 2);
+    ASSERT_FALSE(jenv->ExceptionCheck());
+    jenv->CallStaticLongMethod((jclass)c.get(), id, 1);
+    ASSERT_TRUE(jenv->ExceptionCheck());
+    jenv->ExceptionClear();
+    auto obj = std::make_shared<Class1>();
+    auto nobj = jnivm::JNITypes<Class1>::ToJNIType(env.get(), obj);
+    auto field = jenv->GetFieldID((jclass)c.get(), "b", "Z");
+    jenv->SetBooleanField(nobj, field, true);
+    ASSERT_TRUE(obj->b);
+    auto fid = (jnivm::Field*)field;
+    ASSERT_THROW(fid->getnativehandle->InstanceGet<jint>(env.get(), nobj, nullptr), std::runtime_error);
+    value.i = 0;
+    ASSERT_THROW(fid->setnativehandle->InstanceSet<jint>(env.get(), nobj, &value), std::runtime_error);
+    ASSERT_TRUE(obj->b);
+}
+
+TEST(JNIVM, CallMethodBatch) {
+    jnivm::VM vm;
+    class BatchBase : public jnivm::Extends<> {
+    public:
+        jint value = 0;
+    };
+    class BatchDerived : public jnivm::Extends<BatchBase> {};
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass<BatchBase>("BatchBase");
+    auto c2 = env->GetClass<BatchDerived>("BatchDerived");
+    c->HookInstanceFunction(env, "Value", [](BatchBase* self, jint a) {
+        if(a < 0) {
+            throw std::runtime_error("negative");
+        }
+        return self->value + a;
+    });
+    c2->HookInstanceFunction(env, "Value", [](BatchDerived*, jint a) {
+        return -a;
+    });
+    c->HookInstanceFunction(env, "Self", [](BatchBase* self) {
+        return std::dynamic_pointer_cast<BatchBase>(self->shared_from_this());
+    });
+    auto jenv = env->GetJNIEnv();
+    auto value = jenv->GetMethodID((jclass)c.get(), "Value", "(I)I");
+    auto self = jenv->GetMethodID((jclass)c.get(), "Self", "()LBatchBase;");
+    auto unknown = jenv->GetMethodID((jclass)c.get(), "Unknown", "()I");
+    auto b1 = std::make_shared<BatchBase>();
+    b1->value = 1;
+    auto b2 = std::make_shared<BatchBase>();
+    b2->value = 2;
+    jobject receivers[] = {
+        jnivm::JNITypes<decltype(b1)>::ToJNIReturnType(env, b1),
+        jnivm::JNITypes<std::shared_ptr<BatchDerived>>::ToJNIReturnType(env, std::make_shared<BatchDerived>()),
+        jnivm::JNITypes<decltype(b2)>::ToJNIReturnType(env, b2),
+    };
+    jvalue args[3];
+    args[0].i = 10;
+    args[1].i = 20;
+    args[2].i = 30;
+    jvalue results[3];
+    ASSERT_EQ(env->CallMethodBatch(value, receivers, 3, args, 1, results), 3);
+    ASSERT_EQ(results[0].i, 11);
+    ASSERT_EQ(results[1].i, -20);
+    ASSERT_EQ(results[2].i, 32);
+    // Stride 0 passes the same arguments to every receiver
+    ASSERT_EQ(env->CallMethodBatch(value, receivers, 3, args, 0, results), 3);
+    ASSERT_EQ(results[0].i, 11);
+    ASSERT_EQ(results[1].i, -10);
+    ASSERT_EQ(results[2].i, 12);
+    // Stops at the first exception and leaves it pending
+    args[2].i = -1;
+    ASSERT_EQ(env->CallMethodBatch(value, receivers, 3, args, 1, nullptr), 2);
+    ASSERT_TRUE(jenv->ExceptionCheck());
+    ASSERT_EQ(env->CallMethodBatch(value, receivers, 3, args, 1, nullptr), 0);
+    jenv->ExceptionClear();
+    // Unresolved methods use the stub like CallIntMethodA
+    ASSERT_EQ(env->CallMethodBatch(unknown, receivers, 3, nullptr, 0, results), 3);
+    ASSERT_EQ(results[2].i, 0);
+    ASSERT_FALSE(jenv->ExceptionCheck());
+
+    // Thread safe hooks are split across threads, returned objects become local references of the caller
+    ((jnivm::Method*)self)->threadsafe = true;
+    std::vector<jobject> many(4096);
+    for(size_t i = 0; i < many.size(); ++i) {
+        many[i] = receivers[i % 3];
+    }
+    std::vector<jvalue> manyresults(many.size());
+    ASSERT_EQ(env->CallMethodBatch(self, many.data(), many.size(), nullptr, 0, manyresults.data(), 4), many.size());
+    for(size_t i = 0; i < many.size(); ++i) {
+        ASSERT_EQ(manyresults[i].l, many[i]);
+    }
+    ASSERT_FALSE(jenv->ExceptionCheck());
+}
+
+TEST(JNIVM, LocalReferenceTable) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto jenv = env->GetJNIEnv();
+    auto&& table = env->localrefs;
+    auto base = table.Size();
+    auto a = std::make_shared<jnivm::Object>();
+    auto b = std::make_shared<jnivm::Object>();
+    auto ra = table.Add(a);
+    auto ra2 = table.Add(a);
+    auto rb = table.Add(b);
+    ASSERT_EQ(table.Size(), base + 3);
+    ASSERT_EQ(table.Get(ra), a.get());
+    // Deletes the newest reference of a
+    ASSERT_TRUE(table.Remove(a.get()));
+    ASSERT_EQ(table.Get(ra2), nullptr);
+    ASSERT_EQ(table.Get(ra), a.get());
+    ASSERT_TRUE(table.Contains(a.get()));
+    ASSERT_TRUE(table.Remove(a.get()));
+    ASSERT_FALSE(table.Contains(a.get()));
+    // Stale deletes are detected
+    ASSERT_FALSE(table.Remove(a.get()));
+    ASSERT_EQ(a.use_count(), 1);
+    // Freed slots are reused with a new generation
+    auto ra3 = table.Add(a);
+    ASSERT_EQ(table.Get(ra), nullptr);
+    ASSERT_EQ(table.Get(ra3), a.get());
+
+    auto frames = table.Frames();
+    ASSERT_EQ(jenv->PushLocalFrame(4), 0);
+    ASSERT_EQ(table.Frames(), frames + 1);
+    auto inner = jenv->NewLocalRef((jobject)b.get());
+    ASSERT_EQ(inner, (jobject)b.get());
+    ASSERT_EQ(b.use_count(), 3);
+    // Deleting a reference of an older frame keeps the slot in that frame
+    jenv->DeleteLocalRef((jobject)a.get());
+    ASSERT_EQ(a.use_count(), 1);
+    for(int i = 0; i < 100; i++) {
+        jenv->NewLocalRef((jobject)a.get());
+    }
+    ASSERT_EQ(a.use_count(), 101);
+    ASSERT_EQ(jenv->PopLocalFrame((jobject)a.get()), (jobject)a.get());
+    ASSERT_EQ(table.Frames(), frames);
+    // Only the result survives the frame
+    ASSERT_EQ(a.use_count(), 2);
+    ASSERT_EQ(b.use_count(), 2);
+    ASSERT_EQ(table.Get(rb), b.get());
+    ASSERT_EQ(table.Size(), base + 2);
+    jenv->DeleteLocalRef((jobject)a.get());
+    jenv->DeleteLocalRef((jobject)b.get());
+    ASSERT_EQ(table.Size(), base);
+    ASSERT_EQ(a.use_count(), 1);
+    ASSERT_EQ(b.use_count(), 1);
+
+    std::vector<std::shared_ptr<jnivm::Object>> objects(1000);
+    for(auto&& obj : objects) {
+        obj = std::make_shared<jnivm::Object>();
+        table.Add(obj);
+    }
+    for(size_t i = 0; i < objects.size(); i += 2) {
+        ASSERT_TRUE(table.Remove(objects[i].get()));
+    }
+    for(size_t i = 0; i < objects.size(); i++) {
+        ASSERT_EQ(table.Contains(objects[i].get()), i % 2 == 1);
+    }
+    for(size_t i = 1; i < objects.size(); i += 2) {
+        ASSERT_TRUE(table.Remove(objects[i].get()));
+    }
+    ASSERT_EQ(table.Size(), base);
+}
+
+TEST(JNIVM, GlobalReferenceTable) {
+    jnivm::VM vm;
+    auto base = vm.globals.Size();
+    auto obj = std::make_shared<jnivm::Object>();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([jni = vm.GetJavaVM(), o = (jobject)obj.get()]() {
+            JNIEnv* env;
+            jni->AttachCurrentThread(&env, nullptr);
+            std::vector<jobject> refs;
+            for(int i = 0; i < 1000; i++) {
+                refs.push_back(i % 2 ? env->NewGlobalRef(o) : env->NewWeakGlobalRef(o));
+            }
+            for(int i = 0; i < 1000; i += 2) {
+                env->DeleteWeakGlobalRef(refs[i]);
+            }
+            for(int i = 1; i < 1000; i += 4) {
+                env->DeleteGlobalRef(refs[i]);
+            }
+            jni->DetachCurrentThread();
+        });
+    }
+    for(auto&& thread : threads) {
+        thread.join();
+    }
+    // 250 strong references per thread are left
+    ASSERT_EQ(vm.globals.Size(), base + 1000);
+    ASSERT_EQ(obj.use_count(), 1001);
+    auto env = vm.GetJNIEnv();
+    auto ref = env->NewGlobalRef((jobject)obj.get());
+    ASSERT_EQ(env->GetObjectRefType(ref), JNIGlobalRefType);
+    env->DeleteGlobalRef(ref);
+    ASSERT_EQ(vm.globals.Size(), base + 1000);
+    // Stale ids are rejected
+    auto other = std::make_shared<jnivm::Object>();
+    auto id = vm.globals.Add(other);
+    ASSERT_FALSE(vm.globals.Remove(id, obj.get()));
+    ASSERT_TRUE(vm.globals.Remove(id, other.get()));
+    ASSERT_FALSE(vm.globals.Remove(id, other.get()));
+    ASSERT_EQ(other.use_count(), 1);
+}
+
+TEST(JNIVM, LocalReferencePinning) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto jenv = env->GetJNIEnv();
+    auto c = env->GetClass("LocalReferencePinning");
+    ASSERT_EQ(c->pinned.owner, vm.GetId());
+    auto classes = c.use_count();
+    auto cl = jenv->FindClass("LocalReferencePinning");
+    ASSERT_EQ(cl, (jclass)c.get());
+    ASSERT_EQ(c.use_count(), classes);
+    ASSERT_EQ(jenv->GetObjectRefType(cl), JNILocalRefType);
+    jenv->DeleteLocalRef(cl);
+    ASSERT_FALSE(env->localrefs.Contains(c.get()));
+
+    auto obj = std::make_shared<jnivm::Object>();
+    vm.Pin(obj);
+    ASSERT_EQ(obj->pinned.owner, vm.GetId());
+    ASSERT_EQ(obj.use_count(), 2);
+    vm.Pin(obj);
+    ASSERT_EQ(obj.use_count(), 2);
+    c->Hook(env.get(), "get", [obj]() {
+        return obj;
+    });
+    auto id = jenv->GetStaticMethodID(cl, "get", "()Ljava/lang/Object;");
+    auto count = obj.use_count();
+    ASSERT_EQ(jenv->PushLocalFrame(4), 0);
+    auto ref = jenv->CallStaticObjectMethod(cl, id);
+    ASSERT_EQ(ref, (jobject)obj.get());
+    ASSERT_EQ(obj.use_count(), count);
+    ASSERT_EQ(jenv->NewLocalRef(ref), ref);
+    ASSERT_EQ(obj.use_count(), count);
+    // Pinned references still survive PopLocalFrame
+    auto result = jenv->PopLocalFrame(ref);
+    ASSERT_EQ(result, ref);
+    ASSERT_TRUE(env->localrefs.Contains(obj.get()));
+    jenv->DeleteLocalRef(result);
+    ASSERT_FALSE(env->localrefs.Contains(obj.get()));
+
+    // Copies are not pinned
+    auto copy = std::make_shared<jnivm::Object>(*obj);
+    ASSERT_EQ(copy->pinned.owner, 0);
+}
+
+TEST(JNIVM, ClassRef) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto c = env->GetClass("ClassRef");
+    auto obj = std::make_shared<jnivm::Object>();
+    std::shared_ptr<jnivm::Class> owner;
+    ASSERT_TRUE(obj->clazz.expired());
+    ASSERT_EQ(obj->getClassBorrowed(env.get(), owner), nullptr);
+    obj->clazz = c;
+    ASSERT_EQ(obj->clazz.get(env.get()), c.get());
+    ASSERT_EQ(obj->clazz.lock(), c);
+    ASSERT_EQ(obj->getClassBorrowed(env.get(), owner), c.get());
+    ASSERT_FALSE(owner);
+    // Classes not owned by a VM are only referenced weakly, the caller keeps them alive
+    auto unowned = std::make_shared<jnivm::Class>();
+    obj->clazz = unowned;
+    ASSERT_EQ(obj->clazz.get(env.get()), nullptr);
+    ASSERT_EQ(obj->getClassBorrowed(env.get(), owner), unowned.get());
+    ASSERT_EQ(owner, unowned);
+    owner.reset();
+    unowned.reset();
+    ASSERT_TRUE(obj->clazz.expired());
+    ASSERT_EQ(obj->getClassBorrowed(env.get(), owner), nullptr);
+    // Classes pinned by another VM are not borrowed and expire with their VM
+    {
+        jnivm::VM other;
+        obj->clazz = other.GetEnv()->GetClass("ClassRef");
+        ASSERT_EQ(obj->clazz.get(env.get()), nullptr);
+        auto borrowed = obj->getClassBorrowed(env.get(), owner);
+        ASSERT_TRUE(owner);
+        ASSERT_EQ(borrowed, owner.get());
+        owner.reset();
+    }
+    ASSERT_TRUE(obj->clazz.expired());
+    ASSERT_EQ(obj->getClassBorrowed(env.get(), owner), nullptr);
+}
+
+TEST(JNIVM, CollectWeak) {
+    jnivm::VM vm;
+    auto env = vm.GetJNIEnv();
+    auto base = vm.globals.Weaks();
+    auto obj = std::make_shared<jnivm::Object>();
+    std::vector<jweak> refs;
+    for(int i = 0; i < 10; i++) {
+        refs.push_back(env->NewWeakGlobalRef((jobject)obj.get()));
+    }
+    auto alive = std::make_shared<jnivm::Object>();
+    auto aliveref = env->NewWeakGlobalRef((jobject)alive.get());
+    ASSERT_EQ(vm.globals.Weaks().live, base.live + 11);
+    std::weak_ptr<jnivm::Object> observer = obj;
+    obj.reset();
+    // Every weak reference keeps the control block of the destroyed object
+    ASSERT_EQ(observer.use_count(), 0);
+    ASSERT_EQ(vm.CollectWeak(), 10);
+    ASSERT_EQ(vm.CollectWeak(), 0);
+    auto stats = vm.globals.Weaks();
+    ASSERT_EQ(stats.live, base.live + 1);
+    ASSERT_EQ(stats.dead, base.dead + 10);
+    for(auto&& ref : refs) {
+        auto weak = std::dynamic_pointer_cast<jnivm::Weak>(std::shared_ptr<jnivm::Object>(((jnivm::Object*)ref)->shared_from_this()));
+        // The control block was released
+        std::weak_ptr<jnivm::Object> empty;
+        ASSERT_FALSE(weak->wrapped.owner_before(empty) || empty.owner_before(weak->wrapped));
+        ASSERT_TRUE(env->IsSameObject(ref, nullptr));
+        env->DeleteWeakGlobalRef(ref);
+    }
+    ASSERT_EQ(vm.globals.Weaks().dead, base.dead);
+    ASSERT_FALSE(env->IsSameObject(aliveref, nullptr));
+    env->DeleteWeakGlobalRef(aliveref);
+    ASSERT_EQ(vm.globals.Weaks().live, base.live);
+}
+
+TEST(JNIVM, ReferenceMonitor) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto jenv = env->GetJNIEnv();
+    std::vector<std::pair<jnivm::ReferenceKind, std::size_t>> reports;
+    jnivm::ReferenceMonitor monitor;
+    monitor.locals = env->localrefs.Size() + 100;
+    monitor.globals = vm.globals.Peak() + 50;
+    monitor.callback = [&](jnivm::ENV* e, jnivm::ReferenceKind kind, std::size_t count) {
+        ASSERT_EQ(e, kind == jnivm::ReferenceKind::Local ? env.get() : nullptr);
+        reports.emplace_back(kind, count);
+    };
+    vm.SetReferenceMonitor(monitor);
+    auto obj = std::make_shared<jnivm::Object>();
+    ASSERT_EQ(jenv->PushLocalFrame(16), 0);
+    for(int i = 0; i < 250; i++) {
+        jenv->NewLocalRef((jobject)obj.get());
+    }
+    auto stats = env->localrefs.GetStats();
+    ASSERT_EQ(stats.framerefs, 250);
+    ASSERT_EQ(stats.peak, stats.live);
+    // Reported at the threshold and once more after doubling it
+    ASSERT_EQ(reports.size(), 2);
+    ASSERT_EQ(reports[0].first, jnivm::ReferenceKind::Local);
+    ASSERT_EQ(reports[0].second, monitor.locals);
+    ASSERT_EQ(reports[1].second, monitor.locals * 2);
+    jenv->PopLocalFrame(nullptr);
+    auto after = env->localrefs.GetStats();
+    ASSERT_EQ(after.live, stats.live - 250);
+    ASSERT_EQ(after.peak, stats.peak);
+    ASSERT_EQ(after.pushed, stats.pushed);
+    ASSERT_EQ(after.popped, stats.popped + 1);
+    // Popping the bottom frame is counted instead of failing
+    jenv->PopLocalFrame(nullptr);
+    ASSERT_EQ(env->localrefs.GetStats().underflows, after.underflows + 1);
+
+    reports.clear();
+    std::vector<jobject> globals;
+    for(int i = 0; i < 60; i++) {
+        globals.push_back(jenv->NewGlobalRef((jobject)obj.get()));
+    }
+    ASSERT_EQ(reports.size(), 1);
+    ASSERT_EQ(reports[0].first, jnivm::ReferenceKind::Global);
+    ASSERT_EQ(reports[0].second, monitor.globals);
+    for(auto&& global : globals) {
+        jenv->DeleteGlobalRef(global);
+    }
+    vm.SetReferenceMonitor({});
+}
+
+TEST(JNIVM, LocalReferenceRetention) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto jenv = env->GetJNIEnv();
+    auto&& table = env->localrefs;
+    table.retain = 256;
+    auto obj = std::make_shared<jnivm::Object>();
+    std::vector<std::shared_ptr<jnivm::Object>> objs;
+    for(int i = 0; i < 10000; i++) {
+        objs.push_back(std::make_shared<jnivm::Object>());
+    }
+    auto before = table.GetStats();
+    ASSERT_EQ(jenv->PushLocalFrame(16), 0);
+    auto outer = jenv->NewLocalRef((jobject)obj.get());
+    ASSERT_EQ(jenv->PushLocalFrame(16), 0);
+    for(auto&& o : objs) {
+        jenv->NewLocalRef((jobject)o.get());
+    }
+    auto burst = table.GetStats();
+    ASSERT_GE(burst.capacity, 10000);
+    ASSERT_GE(burst.buckets, 20000);
+    jenv->PopLocalFrame(nullptr);
+    // The burst is released, the outer frame stays intact
+    auto after = table.GetStats();
+    ASSERT_EQ(after.shrinks, before.shrinks + 1);
+    ASSERT_LE(after.capacity, 2 * table.retain);
+    ASSERT_LT(after.buckets, burst.buckets);
+    ASSERT_TRUE(table.Contains((jnivm::Object*)outer));
+    ASSERT_EQ(objs[0].use_count(), 1);
+    jenv->DeleteLocalRef(outer);
+    ASSERT_EQ(obj.use_count(), 1);
+    jenv->PopLocalFrame(nullptr);
+    // Frames within the cap keep their memory
+    ASSERT_EQ(jenv->PushLocalFrame(16), 0);
+    for(int i = 0; i < 200; i++) {
+        jenv->NewLocalRef((jobject)objs[i].get());
+    }
+    jenv->PopLocalFrame(nullptr);
+    ASSERT_EQ(table.GetStats().shrinks, after.shrinks);
+}
+
+namespace {
+    class KindBase : public jnivm::Extends<> {
+    public:
+        int value = 1;
+    };
+    class KindOther : public jnivm::Extends<> {
+    };
+    class KindDerived : public jnivm::Extends<KindOther, KindBase> {
+    public:
+        KindDerived() {
+            value = 2;
+        }
+    };
+}
+
+TEST(JNIVM, ObjectKind) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv().get();
+    auto jenv = env->GetJNIEnv();
+    ASSERT_EQ(env->GetClass("ObjectKind")->kind, jnivm::ObjectKind::Class);
+    ASSERT_EQ(std::make_shared<jnivm::String>("")->kind, jnivm::ObjectKind::String);
+    ASSERT_EQ(std::make_shared<jnivm::Array<jint>>(1)->kind, jnivm::ObjectKind::Array);
+    auto base = std::make_shared<KindBase>();
+    auto derived = std::make_shared<KindDerived>();
+    auto other = std::make_shared<KindOther>();
+    auto rbase = (jobject)static_cast<jnivm::Object*>(base.get());
+    auto rderived = (jobject)static_cast<jnivm::Object*>(derived.get());
+    auto rother = (jobject)static_cast<jnivm::Object*>(other.get());
+    // The cached offset of one dynamic type must not be applied to another one
+    for(int i = 0; i < 3; i++) {
+        ASSERT_EQ(jnivm::JNITypes<std::shared_ptr<KindBase>>::JNICast(env, rbase)->value, 1);
+        ASSERT_EQ(jnivm::JNITypes<std::shared_ptr<KindBase>>::JNICast(env, rderived)->value, 2);
+        ASSERT_THROW(jnivm::JNITypes<std::shared_ptr<KindBase>>::JNICast(env, rother), std::runtime_error);
+    }
+    auto global = jenv->NewGlobalRef(rderived);
+    auto weak = jenv->NewWeakGlobalRef(rderived);
+    ASSERT_EQ(((jnivm::Object*)global)->kind, jnivm::ObjectKind::Global);
+    ASSERT_EQ(((jnivm::Object*)weak)->kind, jnivm::ObjectKind::Weak);
+    ASSERT_EQ(jnivm::JNITypes<std::shared_ptr<KindBase>>::JNICast(env, global), derived);
+    ASSERT_EQ(jnivm::JNITypes<std::shared_ptr<KindBase>>::JNICast(env, weak), derived);
+    // Copies of a wrapper keep their kind
+    ASSERT_EQ(jnivm::Weak(*jnivm::JNITypes<std::shared_ptr<jnivm::Weak>>::JNICast(env, weak)).kind, jnivm::ObjectKind::Weak);
+    jenv->DeleteWeakGlobalRef(weak);
+    jenv->DeleteGlobalRef(global);
+}
+
+#ifdef EnableJNIVMPool
+TEST(JNIVM, ObjectPool) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv();
+    auto jenv = env->GetJNIEnv();
+    auto before = env->pool->GetStats();
+    ASSERT_EQ(jenv->PushLocalFrame(16), 0);
+    std::vector<jstring> strings;
+    for(int i = 0; i < 100; i++) {
+        strings.push_back(jenv->NewStringUTF("pooled"));
+    }
+    auto arr = jenv->NewIntArray(4);
+    jenv->SetIntArrayRegion(arr, 0, 1, std::vector<jint>{ 42 }.data());
+    auto global = jenv->NewGlobalRef(strings[0]);
+    auto during = env->pool->GetStats();
+    ASSERT_EQ(during.allocations, before.allocations + 102);
+    jenv->PopLocalFrame(nullptr);
+    ASSERT_EQ(env->pool->GetStats().deallocations, during.deallocations + 100);
+    // Blocks are reused
+    ASSERT_EQ(jenv->PushLocalFrame(16), 0);
+    for(int i = 0; i < 99; i++) {
+        jenv->NewStringUTF("pooled");
+    }
+    ASSERT_EQ(env->pool->GetStats().chunks, during.chunks);
+    jenv->PopLocalFrame(nullptr);
+    // Objects released by another thread are returned to the pool of their ENV
+    std::thread([&]() {
+        JNIEnv* other;
+        vm.GetJavaVM()->AttachCurrentThread(&other, nullptr);
+        auto chars = other->GetStringUTFChars((jstring)global, nullptr);
+        ASSERT_EQ(std::string(chars), "pooled");
+        other->ReleaseStringUTFChars((jstring)global, chars);
+        other->DeleteGlobalRef(global);
+        vm.GetJavaVM()->DetachCurrentThread();
+    }).join();
+    auto after = env->pool->GetStats();
+    ASSERT_EQ(after.remotefrees, during.remotefrees + 2);
+    ASSERT_EQ(after.allocations - after.deallocations, during.allocations - during.deallocations - 102);
+    // The chunks of a burst are released once all of its objects are gone
+    ASSERT_EQ(jenv->PushLocalFrame(16), 0);
+    for(int i = 0; i < 10000; i++) {
+        jenv->NewStringUTF("burst");
+    }
+    ASSERT_GT(env->pool->GetStats().chunks, 1);
+    jenv->PopLocalFrame(nullptr);
+    ASSERT_EQ(env->pool.use_count(), 1);
+    ASSERT_EQ(env->pool->GetStats().chunks, 1);
+    ASSERT_NE(jenv->NewStringUTF("reused"), nullptr);
+
+    // Objects may outlive the ENV and its pool
+    std::shared_ptr<jnivm::String> str;
+    std::thread([&]() {
+        JNIEnv* other;
+        vm.GetJavaVM()->AttachCurrentThread(&other, nullptr);
+        str = jnivm::JNITypes<std::shared_ptr<jnivm::String>>::JNICast(jnivm::ENV::FromJNIEnv(other), other->NewStringUTF("outlives"));
+        vm.GetJavaVM()->DetachCurrentThread();
+    }).join();
+    ASSERT_EQ(*str, "outlives");
+    str.reset();
+
+    // Disabled per ENV
+    env->pool.reset();
+    ASSERT_NE(jenv->NewStringUTF("unpooled"), nullptr);
+}
+#endif
+
+TEST(JNIVM, CachedEnv) {
+    auto vm = std::make_unique<jnivm::VM>();
+    auto env = vm->GetEnv();
+    ASSERT_TRUE(env);
+    ASSERT_EQ(vm->GetEnv(), env);
+    {
+        jnivm::VM other;
+        // Each VM has its own ENV per thread
+        ASSERT_NE(other.GetEnv(), env);
+        ASSERT_EQ(vm->GetEnv(), env);
+    }
+    std::thread([&]() {
+        auto jvm = vm->GetJavaVM();
+        ASSERT_FALSE(vm->GetEnv());
+        JNIEnv* jenv = nullptr;
+        ASSERT_EQ(jvm->GetEnv((void**)&jenv, JNI_VERSION_1_6), JNI_OK);
+        ASSERT_EQ(jnivm::ENV::FromJNIEnv(jenv), vm->GetEnv().get());
+        JNIEnv* again = nullptr;
+        jvm->AttachCurrentThread(&again, nullptr);
+        ASSERT_EQ(again, jenv);
+        jvm->DetachCurrentThread();
+        ASSERT_FALSE(vm->GetEnv());
+        jvm->AttachCurrentThread(&again, nullptr);
+        ASSERT_EQ(jnivm::ENV::FromJNIEnv(again), vm->GetEnv().get());
+        jvm->DetachCurrentThread();
+    }).join();
+    // A new VM never hits entries cached for a destroyed one
+    vm.reset();
+    vm = std::make_unique<jnivm::VM>();
+    ASSERT_TRUE(vm->GetEnv());
+    ASSERT_EQ(vm->GetEnv()->GetVM(), vm.get());
+}
+
+TEST(JNIVM, ConcurrentFindClass) {
+    jnivm::VM vm;
+    auto jvm = vm.GetJavaVM();
+    std::vector<std::thread> threads;
+    std::vector<jnivm::Class*> found(8);
+    for(size_t t = 0; t < found.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            JNIEnv* env;
+            jvm->AttachCurrentThread(&env, nullptr);
+            for(int i = 0; i < 100; ++i) {
+                env->FindClass(("Concurrent" + std::to_string(i)).data());
+                ASSERT_TRUE(vm.FindType(typeid(jnivm::String)));
+            }
+            found[t] = (jnivm::Class*)env->FindClass("Concurrent");
+            jvm->DetachCurrentThread();
+        });
+    }
+    for(auto&& thread : threads) {
+        thread.join();
+    }
+    // Every thread declared the same class once
+    for(auto&& cl : found) {
+        ASSERT_NE(cl, nullptr);
+        ASSERT_EQ(cl, found[0]);
+    }
+    ASSERT_EQ(vm.classes.count("Concurrent99"), 1);
+    ASSERT_EQ(vm.FindType(typeid(int)), nullptr);
+    // The class of a class is set before it is published, returning it to another thread doesn't write to it
+    auto metaclass = vm.classes.at("java/lang/Class").get();
+    auto env = vm.GetEnv().get();
+    ASSERT_EQ(found[0]->clazz.get(env), metaclass);
+    ASSERT_EQ(vm.classes.at("java/lang/Object")->clazz.get(env), metaclass);
+}
+
+TEST(JNIVM, ClassIndex) {
+    jnivm::VM vm;
+    auto env = vm.GetJNIEnv();
+    std::atomic<bool> stop { false };
+    // Reads while the index grows
+    std::thread reader([&]() {
+        while(!stop.load()) {
+            auto entry = vm.classindex.Find("java/lang/String");
+            ASSERT_NE(entry, nullptr);
+            ASSERT_EQ(entry->second, vm.FindType(typeid(jnivm::String)));
+        }
+    });
+    std::vector<jclass> declared;
+    for(int i = 0; i < 1000; ++i) {
+        declared.emplace_back(env->FindClass(("Index" + std::to_string(i)).data()));
+    }
+    stop.store(true);
+    reader.join();
+    for(int i = 0; i < 1000; ++i) {
+        auto name = "Index" + std::to_string(i);
+        auto entry = vm.classindex.Find(name.data());
+        ASSERT_NE(entry, nullptr);
+        ASSERT_EQ(entry->first, name);
+        ASSERT_EQ((jclass)entry->second.get(), declared[i]);
+        ASSERT_EQ(env->FindClass(name.data()), declared[i]);
+    }
+    ASSERT_EQ(vm.classindex.Find("Index1000"), nullptr);
+    ASSERT_EQ(vm.classindex.Size(), vm.classes.size());
+}
+
+TEST(JNIVM, ObjectLock) {
+    static_assert(sizeof(jnivm::ObjectLock) == sizeof(void*), "A thin lock is a single word");
+    jnivm::VM vm;
+    auto env = vm.GetJNIEnv();
+    auto o = std::make_shared<jnivm::Object>();
+    auto obj = (jobject)o.get();
+    ASSERT_EQ(env->MonitorEnter(obj), 0);
+    ASSERT_TRUE(o->lock.IsHeldByCurrentThread());
+    ASSERT_FALSE(o->lock.IsInflated());
+    ASSERT_EQ(env->MonitorExit(obj), 0);
+    ASSERT_EQ(env->MonitorExit(obj), JNI_ERR);
+    ASSERT_FALSE(o->lock.IsInflated());
+    // Recursion inflates
+    env->MonitorEnter(obj);
+    env->MonitorEnter(obj);
+    ASSERT_TRUE(o->lock.IsInflated());
+    env->MonitorExit(obj);
+    ASSERT_TRUE(o->lock.IsHeldByCurrentThread());
+    env->MonitorExit(obj);
+    ASSERT_FALSE(o->lock.IsHeldByCurrentThread());
+
+    auto contended = std::make_shared<jnivm::Object>();
+    size_t counter = 0;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for(int i = 0; i < 10000; ++i) {
+                std::lock_guard<jnivm::ObjectLock> lock(contended->lock);
+                ++counter;
+            }
+        });
+    }
+    for(auto&& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(counter, 40000);
+
+    auto objectclass = env->FindClass("java/lang/Object");
+    auto wait = env->GetMethodID(objectclass, "wait", "()V");
+    auto waittimeout = env->GetMethodID(objectclass, "wait", "(J)V");
+    auto notify = env->GetMethodID(objectclass, "notify", "()V");
+    env->CallVoidMethod(obj, notify);
+    ASSERT_TRUE(env->ExceptionCheck());
+    env->ExceptionClear();
+    env->MonitorEnter(obj);
+    env->CallVoidMethod(obj, waittimeout, (jlong)1);
+    ASSERT_FALSE(env->ExceptionCheck());
+    bool ready = false;
+    std::thread notifier([&]() {
+        auto jvm = vm.GetJavaVM();
+        JNIEnv* tenv;
+        jvm->AttachCurrentThread(&tenv, nullptr);
+        tenv->MonitorEnter(obj);
+        ready = true;
+        tenv->CallVoidMethod(obj, notify);
+        tenv->MonitorExit(obj);
+        jvm->DetachCurrentThread();
+    });
+    while(!ready) {
+        env->CallVoidMethod(obj, wait);
+    }
+    ASSERT_TRUE(o->lock.IsHeldByCurrentThread());
+    env->MonitorExit(obj);
+    notifier.join();
+}
+
+TEST(JNIVM, EnvPool) {
+    jnivm::VM vm;
+    auto jvm = vm.GetJavaVM();
+    auto obj = std::make_shared<jnivm::Object>();
+    std::weak_ptr<jnivm::Object> weak = obj;
+    jnivm::ENV* first = nullptr;
+    std::thread([&]() {
+        JNIEnv* env;
+        jvm->AttachCurrentThread(&env, nullptr);
+        first = jnivm::ENV::FromJNIEnv(env);
+        jnivm::JNITypes<std::shared_ptr<jnivm::Object>>::ToJNIType(first, obj);
+        env->PushLocalFrame(16);
+        jvm->DetachCurrentThread();
+    }).join();
+    obj.reset();
+    // Local references of a detached thread are released, even if the ENV is pooled
+    ASSERT_TRUE(weak.expired());
+    vm.AddHook([](JNINativeInterface& iface) {
+        iface.GetVersion = [](JNIEnv*) -> jint {
+            return 42;
+        };
+    });
+    std::thread([&]() {
+        JNIEnv* env;
+        jvm->AttachCurrentThread(&env, nullptr);
+        auto nenv = jnivm::ENV::FromJNIEnv(env);
+        ASSERT_EQ(nenv, first);
+        ASSERT_EQ(vm.GetEnv().get(), nenv);
+        // Hooks added while the ENV was pooled apply after reuse
+        ASSERT_EQ(env->GetVersion(), 42);
+        auto stats = nenv->localrefs.GetStats();
+        ASSERT_EQ(stats.live, 0);
+        ASSERT_EQ(stats.frames, 1);
+        ASSERT_EQ(stats.pushed, 0);
+        ASSERT_FALSE(env->ExceptionCheck());
+#ifdef EnableJNIVMPool
+        // The pool of the previous thread is rebound to this one
+        ASSERT_TRUE(nenv->pool->IsOwner());
+        // Disables pooling for this ENV, also after reuse
+        nenv->pool.reset();
+#endif
+        jvm->DetachCurrentThread();
+    }).join();
+#ifdef EnableJNIVMPool
+    std::thread([&]() {
+        JNIEnv* env;
+        jvm->AttachCurrentThread(&env, nullptr);
+        auto nenv = jnivm::ENV::FromJNIEnv(env);
+        ASSERT_EQ(nenv, first);
+        ASSERT_FALSE(nenv->pool);
+        ASSERT_NE(env->NewStringUTF("unpooled"), nullptr);
+        jvm->DetachCurrentThread();
+    }).join();
+#endif
+    vm.envpoolsize = 0;
+    std::thread([&]() {
+        JNIEnv* env;
+        jvm->AttachCurrentThread(&env, nullptr);
+        ASSERT_EQ(env->GetVersion(), 42);
+        jvm->DetachCurrentThread();
+    }).join();
+}
+
+TEST(JNIVM, Executor) {
+    jnivm::VM vm;
+    vm.executorthreads = 4;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass("ExecutorTest");
+    c->Hook(env, "Add", [](jint a, jint b) {
+        return a + b;
+    });
+    c->Hook(env, "Name", [](jint i) {
+        return std::make_shared<jnivm::String>("task" + std::to_string(i));
+    });
+    c->Hook(env, "Fail", []() {
+        throw std::runtime_error("Failed");
+    });
+    auto jenv = env->GetJNIEnv();
+    auto add = jenv->GetStaticMethodID((jclass)c.get(), "Add", "(II)I");
+    auto name = jenv->GetStaticMethodID((jclass)c.get(), "Name", "(I)Ljava/lang/String;");
+    auto fail = jenv->GetStaticMethodID((jclass)c.get(), "Fail", "()V");
+    auto&& executor = vm.GetExecutor();
+    ASSERT_EQ(executor.Threads(), 4);
+    std::vector<std::future<jnivm::InvokeResult>> results;
+    for(int i = 0; i < 100; ++i) {
+        jvalue args[2];
+        args[0].i = i;
+        args[1].i = 1;
+        results.emplace_back(executor.Invoke(add, (jobject)c.get(), { args[0], args[1] }));
+    }
+    for(int i = 0; i < 100; ++i) {
+        auto result = results[i].get();
+        ASSERT_FALSE(result.exception);
+        ASSERT_EQ(result.value.i, i + 1);
+    }
+    jvalue arg;
+    arg.i = 7;
+    auto str = executor.Invoke(name, (jobject)c.get(), { arg }).get();
+    ASSERT_TRUE(str.object);
+    ASSERT_EQ(str.value.l, (jobject)str.object.get());
+    ASSERT_EQ(std::static_pointer_cast<jnivm::String>(str.object)->asStdString(), "task7");
+    auto failed = executor.Invoke(fail, (jobject)c.get(), {}).get();
+    ASSERT_TRUE(failed.exception);
+    // Workers have their own ENVs and may submit further tasks
+    auto nested = executor.Submit([&](jnivm::ENV* wenv) {
+        EXPECT_NE(wenv, env);
+        EXPECT_EQ(vm.GetEnv().get(), wenv);
+        return executor.Submit([](jnivm::ENV* inner) {
+            return inner != nullptr;
+        });
+    }).get();
+    ASSERT_TRUE(nested.get());
+    // Every worker waits for a task submitted after all of them are blocked, only helping avoids the deadlock
+    std::atomic<std::size_t> waiting { 0 };
+    std::vector<std::future<bool>> waiters;
+    for(std::size_t i = 0; i < executor.Threads(); ++i) {
+        waiters.emplace_back(executor.Submit([&](jnivm::ENV*) {
+            ++waiting;
+            while(waiting < executor.Threads()) {
+                std::this_thread::yield();
+            }
+            auto inner = executor.Submit([](jnivm::ENV* inner) {
+                return inner != nullptr;
+            });
+            return executor.Wait(inner);
+        }));
+    }
+    for(auto&& waiter : waiters) {
+        ASSERT_TRUE(waiter.get());
+    }
+    auto thrown = executor.Submit([](jnivm::ENV*) -> int {
+        throw std::runtime_error("Task failed");
+    });
+    ASSERT_THROW(thrown.get(), std::runtime_error);
+    vm.StopExecutor();
+}
+
+#include <jnivm/thread.h>
+
+TEST(JNIVM, Thread) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv().get();
+    class Counter : public jnivm::Extends<jnivm::Object, jnivm::Runnable> {};
+    class Worker : public jnivm::Extends<jnivm::Thread> {};
+    std::atomic<int> count { 0 };
+    std::atomic<int> foreign { 0 };
+    auto countertype = env->GetClass<Counter>("ThreadCounter");
+    countertype->Hook(env, "<init>", []() {
+        return std::make_shared<Counter>();
+    });
+    countertype->HookInstanceFunction(env, "run", [&](jnivm::ENV* wenv, Counter*) {
+        if(wenv != env) {
+            ++foreign;
+        }
+        ++count;
+    });
+    auto workertype = env->GetClass<Worker>("ThreadWorker");
+    workertype->Hook(env, "<init>", []() {
+        return std::make_shared<Worker>();
+    });
+    workertype->HookInstanceFunction(env, "run", [&](Worker*) {
+        count += 100;
+    });
+    auto jenv = env->GetJNIEnv();
+    auto counterclass = jenv->FindClass("ThreadCounter");
+    auto counter = jenv->NewObject(counterclass, jenv->GetMethodID(counterclass, "<init>", "()V"));
+    auto threadclass = jenv->FindClass("java/lang/Thread");
+    auto init = jenv->GetMethodID(threadclass, "<init>", "(Ljava/lang/Runnable;)V");
+    auto start = jenv->GetMethodID(threadclass, "start", "()V");
+    auto join = jenv->GetMethodID(threadclass, "join", "()V");
+    auto isAlive = jenv->GetMethodID(threadclass, "isAlive", "()Z");
+    std::vector<jobject> threads;
+    for(int i = 0; i < 8; ++i) {
+        threads.emplace_back(jenv->NewObject(threadclass, init, counter));
+        ASSERT_NE(threads.back(), nullptr);
+        ASSERT_FALSE(jenv->CallBooleanMethod(threads.back(), isAlive));
+        jenv->CallVoidMethod(threads.back(), start);
+        ASSERT_FALSE(jenv->ExceptionCheck());
+    }
+    for(auto&& thread : threads) {
+        jenv->CallVoidMethod(thread, join);
+        ASSERT_FALSE(jenv->CallBooleanMethod(thread, isAlive));
+    }
+    ASSERT_EQ(count, 8);
+    ASSERT_EQ(foreign, 8);
+    // A thread can only be started once
+    jenv->CallVoidMethod(threads[0], start);
+    ASSERT_TRUE(jenv->ExceptionCheck());
+    jenv->ExceptionClear();
+    // Overrides of run are called instead of the target
+    auto workerclass = jenv->FindClass("ThreadWorker");
+    auto worker = jenv->NewObject(workerclass, jenv->GetMethodID(workerclass, "<init>", "()V"));
+    jenv->CallVoidMethod(worker, start);
+    jenv->CallVoidMethod(worker, jenv->GetMethodID(threadclass, "join", "(J)V"), (jlong)10000);
+    ASSERT_EQ(count, 108);
+    // Without a target run does nothing
+    auto empty = jenv->NewObject(threadclass, jenv->GetMethodID(threadclass, "<init>", "()V"));
+    jenv->CallVoidMethod(empty, start);
+    jenv->CallVoidMethod(empty, join);
+    ASSERT_FALSE(jenv->ExceptionCheck());
+    ASSERT_EQ(count, 108);
+    // Targets only need a run method, their native type doesn't have to derive from jnivm::Runnable
+    auto plaintype = env->GetClass("ThreadPlainTarget");
+    plaintype->HookInstanceFunction(env, "run", [&](jnivm::Object*) {
+        count += 1000;
+    });
+    auto plain = std::make_shared<jnivm::Object>();
+    plain->clazz = plaintype;
+    auto plainthread = jenv->NewObject(threadclass, init, (jobject)plain.get());
+    ASSERT_NE(plainthread, nullptr);
+    jenv->CallVoidMethod(plainthread, start);
+    jenv->CallVoidMethod(plainthread, join);
+    ASSERT_FALSE(jenv->ExceptionCheck());
+    ASSERT_EQ(count, 1108);
+}
+
+TEST(JNIVM, ThreadOutlivingVM) {
+    std::atomic<bool> finished { false };
+    {
+        jnivm::VM vm;
+        auto env = vm.GetEnv().get();
+        class Sleeper : public jnivm::Extends<jnivm::Thread> {};
+        auto sleepertype = env->GetClass<Sleeper>("ThreadSleeper");
+        sleepertype->HookInstanceFunction(env, "run", [&](Sleeper*) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            finished = true;
+        });
+        auto sleeper = std::make_shared<Sleeper>();
+        sleeper->clazz = sleepertype;
+        sleeper->Start(env);
+    }
+    // Destroying the VM waited for the thread
+    ASSERT_TRUE(finished);
+}
+
+TEST(JNIVM, HookWithSignature) {
+    jnivm::VM vm;
+    auto env = vm.GetEnv().get();
+    auto c = env->GetClass("HookWithSignature");
+    c->Hook(env, "wrap", "(Ljava/lang/Runnable;I)Ljava/lang/Object;", [](jnivm::ENV*, std::shared_ptr<jnivm::Object> target, jint count) {
+        return count > 0 ? target : nullptr;
+    });
+    {
+        std::lock_guard<jnivm::ClassMutex> lock(c->mtx);
+        // Only installed under the explicit signature
+        ASSERT_EQ(c->FindMethod("wrap", "(Ljava/lang/Object;I)Ljava/lang/Object;", jnivm::MemberKind::Static), nullptr);
+        ASSERT_NE(c->FindMethod("wrap", "(Ljava/lang/Runnable;I)Ljava/lang/Object;", jnivm::MemberKind::Static), nullptr);
+    }
+    auto jenv = env->GetJNIEnv();
+    auto cl = jenv->FindClass("HookWithSignature");
+    auto wrap = jenv->GetStaticMethodID(cl, "wrap", "(Ljava/lang/Runnable;I)Ljava/lang/Object;");
+    auto obj = jenv->AllocObject(cl);
+    ASSERT_EQ(jenv->CallStaticObjectMethod(cl, wrap, obj, 1), obj);
+    ASSERT_EQ(jenv->CallStaticObjectMethod(cl, wrap, obj, 0), nullptr);
+}
+
+TEST(JNIVM, LockProfile) {
+    jnivm::VM vm;
+    jnivm::VM::ResetLockProfile();
+    auto jenv = vm.GetJNIEnv();
+    auto c = jenv->FindClass("LockProfileTest");
+    ASSERT_NE(jenv->GetMethodID(c, "Test", "()V"), nullptr);
+    jenv->MonitorEnter(c);
+    std::thread contender([&]() {
+        JNIEnv* tenv = nullptr;
+        vm.GetJavaVM()->AttachCurrentThread(&tenv, nullptr);
+        tenv->MonitorEnter(c);
+        tenv->MonitorExit(c);
+        vm.GetJavaVM()->DetachCurrentThread();
+    });
+    // The contender inflates the lock once it stopped spinning
+    while(!((jnivm::Object*)c)->lock.IsInflated()) {
+        std::this_thread::yield();
+    }
+    jenv->MonitorExit(c);
+    contender.join();
+    auto profiles = jnivm::VM::GetLockProfile();
+    auto report = jnivm::VM::GetLockReport();
+#ifdef EnableJNIVMLockProfiler
+    auto find = [&](const char* name) {
+        auto profile = std::find_if(profiles.begin(), profiles.end(), [name](const jnivm::LockProfile& p) {
+            return p.name == name;
+        });
+        return profile != profiles.end() ? &*profile : nullptr;
+    };
+    auto callsite = [](const jnivm::LockProfile* profile, const char* name) {
+        auto callsite = std::find_if(profile->callsites.begin(), profile->callsites.end(), [name](const jnivm::LockProfile::Callsite& c) {
+            return c.name == name;
+        });
+        return callsite != profile->callsites.end() ? &*callsite : nullptr;
+    };
+    auto classmtx = find("Class::mtx");
+    ASSERT_NE(classmtx, nullptr);
+    ASSERT_NE(callsite(classmtx, "GetMethodID"), nullptr);
+    auto monitor = find("Object monitor");
+    ASSERT_NE(monitor, nullptr);
+    ASSERT_EQ(monitor->acquisitions, 2);
+    ASSERT_EQ(monitor->contended, 1);
+    ASSERT_GT(monitor->waitns, 0);
+    auto enter = callsite(monitor, "MonitorEnter");
+    ASSERT_NE(enter, nullptr);
+    ASSERT_EQ(enter->contended, 1);
+    std::uint64_t histogram = 0;
+    for(auto&& bucket : monitor->histogram) {
+        histogram += bucket;
+    }
+    ASSERT_EQ(histogram, monitor->acquisitions);
+    ASSERT_NE(report.find("Object monitor"), std::string::npos);
+    jnivm::VM::ResetLockProfile();
+    ASSERT_TRUE(jnivm::VM::GetLockProfile().empty());
+#else
+    ASSERT_TRUE(profiles.empty());
+    ASSERT_FALSE(report.empty());
+#endif
+}